@@ -0,0 +1,333 @@
+#include "base/base.h"
+#include "base/basis.h"
+#include "basis/basis.h"
+#include "integrals/obara-saika/obara-saika.h"
+#include "integrals/shell_pair.h"
+#include "io/json.h"
+#include "parallel/task_pool.h"
+#include "symmetry/symmetry.h"
+#include "molecules.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Microbenchmarks of the integral and basis kernels
+//
+// Usage: planck-bench [--filter <text>] [--json <file>] [--samples <n>] [--min-time <seconds>]
+//
+// Every case is first run until one sample lasts at least --min-time, then
+// timed for --samples samples of that many iterations. The median time per
+// call and its median absolute deviation are the figures to compare between
+// builds; min, mean and standard deviation are reported alongside. Cases
+// sweep the angular momentum, the contraction depth and the molecule size.
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using Params = std::vector<std::pair<std::string, std::string>>;
+
+    // Keep the compiler from discarding a result that is never used
+    template <typename T>
+    void keep(const T &value)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+#endif
+    }
+
+    struct Options
+    {
+        std::string filter;
+        std::string json_file;
+        std::size_t samples = 15;
+        double min_time = 0.01;
+    };
+
+    struct Result
+    {
+        std::string name;
+        Params params;
+        std::size_t iterations = 0; // calls per sample
+        std::size_t samples = 0;
+
+        // Nanoseconds per call
+        double median = 0.0;
+        double mad = 0.0;
+        double min = 0.0;
+        double mean = 0.0;
+        double stddev = 0.0;
+    };
+
+    double median_of(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        const std::size_t n = values.size();
+        return (n % 2) ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+    }
+
+    class Runner
+    {
+    public:
+        explicit Runner(const Options &options) : options_(options) {}
+
+        // Time body() as one case; skipped unless "name/params" contains the filter
+        template <typename Body>
+        void run(const std::string &name, const Params &params, Body &&body)
+        {
+            std::string label = name;
+            for (const auto &[key, value] : params)
+                label += std::format("/{}={}", key, value);
+
+            if (!options_.filter.empty() && label.find(options_.filter) == std::string::npos)
+                return;
+
+            // Calibrate (this also warms caches and the thread pool)
+            std::size_t iterations = 1;
+            while (true)
+            {
+                const double elapsed = time(body, iterations);
+                if (elapsed >= options_.min_time || iterations >= (std::size_t{1} << 30))
+                    break;
+
+                // Aim a little past the target, at most 100x per round
+                const double factor = elapsed > 0.0 ? 1.2 * options_.min_time / elapsed : 100.0;
+                iterations = std::max(iterations + 1, static_cast<std::size_t>(static_cast<double>(iterations) * std::min(factor, 100.0)));
+            }
+
+            std::vector<double> per_call(options_.samples);
+            for (double &t : per_call)
+                t = 1e9 * time(body, iterations) / static_cast<double>(iterations);
+
+            Result result{name, params, iterations, per_call.size()};
+            result.median = median_of(per_call);
+            result.min = *std::min_element(per_call.begin(), per_call.end());
+            result.mean = std::accumulate(per_call.begin(), per_call.end(), 0.0) / static_cast<double>(per_call.size());
+
+            std::vector<double> deviations;
+            double variance = 0.0;
+            for (double t : per_call)
+            {
+                deviations.push_back(std::abs(t - result.median));
+                variance += (t - result.mean) * (t - result.mean);
+            }
+            result.mad = median_of(deviations);
+            result.stddev = per_call.size() > 1 ? std::sqrt(variance / static_cast<double>(per_call.size() - 1)) : 0.0;
+
+            std::cout << std::format("  {:<52} {:>14.1f} {:>8.2f}% {:>14.1f} {:>12}\n", label, result.median,
+                                     100.0 * result.mad / result.median, result.min, iterations);
+            results_.push_back(std::move(result));
+        }
+
+        const std::vector<Result> &results() const noexcept { return results_; }
+
+    private:
+        template <typename Body>
+        static double time(Body &body, std::size_t iterations)
+        {
+            const auto start = Clock::now();
+            for (std::size_t i = 0; i < iterations; ++i)
+                body();
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        }
+
+        Options options_;
+        std::vector<Result> results_;
+    };
+
+    std::string to_json(const std::vector<Result> &results)
+    {
+        std::string out = std::format("{{\"threads\":{},\"unit\":\"ns\",\"benchmarks\":[", TaskPool::max_threads());
+
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+
+            std::format_to(std::back_inserter(out), "{}\n  {{\"name\":\"{}\",\"params\":{{", i ? "," : "", json_escape(r.name));
+            for (std::size_t p = 0; p < r.params.size(); ++p)
+                std::format_to(std::back_inserter(out), "{}\"{}\":\"{}\"", p ? "," : "", json_escape(r.params[p].first), json_escape(r.params[p].second));
+
+            std::format_to(std::back_inserter(out), "}},\"iterations\":{},\"samples\":{},\"median\":{:.3f},\"mad\":{:.3f},\"min\":{:.3f},\"mean\":{:.3f},\"stddev\":{:.3f}}}",
+                           r.iterations, r.samples, r.median, r.mad, r.min, r.mean, r.stddev);
+        }
+
+        out += results.empty() ? "]}\n" : "\n]}\n";
+        return out;
+    }
+
+    // Two hydrogen atoms 1.4 bohr apart, each carrying one shell of angular
+    // momentum L contracted from nprim primitives
+    Basis shell_pair_basis(int L, std::size_t nprim)
+    {
+        Molecule molecule;
+        molecule.natoms = 2;
+        molecule.atomic_numbers = {1, 1};
+        molecule.coordinates = {0.0, 0.0, 0.0, 0.0, 0.0, 1.4};
+
+        std::vector<double> exponents, coefficients;
+        for (std::size_t i = 0; i < nprim; ++i)
+        {
+            exponents.push_back(30.0 * std::pow(0.3, static_cast<double>(i)));
+            coefficients.push_back(1.0 / static_cast<double>(nprim));
+        }
+
+        return place_shells(molecule, ShellType::Cartesian, [&](std::uint64_t Z, Basis &basis)
+                            { add_shell_template(basis, Z, L, exponents, coefficients); });
+    }
+
+    void primitive_benchmarks(Runner &runner)
+    {
+        for (int L = 0; L <= MAX_SHELL_L; ++L)
+        {
+            runner.run("primitive_1d", {{"L", std::to_string(L)}}, [L]
+                       { keep(ObaraSaika::Overlap::computePrimitive1D(L, L, 0.31, -0.52, 0.17)); });
+        }
+    }
+
+    void shell_pair_benchmarks(Runner &runner)
+    {
+        for (int L = 0; L <= 3; ++L)
+        {
+            for (std::size_t nprim : {1, 3, 6})
+            {
+                const Basis basis = shell_pair_basis(L, nprim);
+                const Params params = {{"L", std::to_string(L)}, {"nprim", std::to_string(nprim)}};
+
+                std::vector<double> storage(5 * nprim * nprim);
+                runner.run("shell_pair", params, [&]
+                           {
+                    ShellPair pair(basis, 0, 1);
+                    pair.compute_primitive_pairs(basis, storage);
+                    keep(pair.prefac.data()); });
+
+                // Every Cartesian component pair of the shell-pair block
+                ShellPair pair(basis, 0, 1);
+                pair.compute_primitive_pairs(basis, storage);
+                const auto cart = cartesian_shell_order(L);
+                runner.run("contracted", params, [&]
+                           {
+                    for (const auto &a : cart)
+                        for (const auto &b : cart)
+                            keep(ObaraSaika::Overlap::computeContracted(a, b, pair)); });
+            }
+        }
+    }
+
+    void overlap_benchmarks(Runner &runner)
+    {
+        for (const char *basis_name : {"sto-3g", "6-31g*"})
+        {
+            for (std::size_t nwaters : {1, 8, 27, 64})
+            {
+                const Basis basis = read_gbs_basis(get_basis_path() + "/" + basis_name, water_lattice(nwaters), ShellType::Cartesian);
+                runner.run("overlap", {{"basis", basis_name}, {"waters", std::to_string(nwaters)}}, [&]
+                           { keep(ObaraSaika::Overlap::computeOverlap(basis, BatchDistribution::Local).data()); });
+            }
+        }
+    }
+
+    void read_gbs_benchmarks(Runner &runner)
+    {
+        for (const char *basis_name : {"sto-3g", "3-21g", "6-31g", "6-31g*"})
+        {
+            const std::string filename = get_basis_path() + "/" + basis_name;
+            runner.run("read_gbs", {{"basis", basis_name}}, [&]
+                       { keep(read_gbs(filename).size()); });
+        }
+    }
+
+    void symmetry_benchmarks(Runner &runner)
+    {
+        for (std::size_t nwaters : {1, 8, 27})
+        {
+            const Molecule molecule = water_lattice(nwaters);
+
+            // detectSymmetry writes into the molecule, so every call gets a copy
+            runner.run("symmetry", {{"waters", std::to_string(nwaters)}}, [&]
+                       {
+                Molecule copy = molecule;
+                keep(detectSymmetry(copy).has_value()); });
+        }
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    Options options;
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        const std::string option = argv[arg];
+        if (arg + 1 >= argc)
+        {
+            std::cerr << std::format("Usage: {} [--filter <text>] [--json <file>] [--samples <n>] [--min-time <seconds>]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+
+        const std::string value = argv[++arg];
+        if (option == "--filter")
+            options.filter = value;
+        else if (option == "--json")
+            options.json_file = value;
+        else if (option == "--samples")
+            options.samples = std::max<std::size_t>(1, std::stoul(value));
+        else if (option == "--min-time")
+            options.min_time = std::stod(value);
+        else
+        {
+            std::cerr << std::format("Unknown option {}\n", option);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << std::format("# {} threads, {} samples of at least {} s\n", TaskPool::max_threads(), options.samples, options.min_time);
+    std::cout << std::format("# {:<52} {:>14} {:>9} {:>14} {:>12}\n", "case", "median (ns)", "mad", "min (ns)", "iterations");
+
+    Runner runner(options);
+    primitive_benchmarks(runner);
+    shell_pair_benchmarks(runner);
+    overlap_benchmarks(runner);
+    read_gbs_benchmarks(runner);
+    symmetry_benchmarks(runner);
+
+    if (!options.json_file.empty())
+    {
+        std::ofstream file(options.json_file, std::ios::trunc);
+        file << to_json(runner.results());
+        if (!file)
+        {
+            std::cerr << std::format("Cannot write {}\n", options.json_file);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <vector>
+
+#include "base/base.h"
+#include "lookup/elements.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Synthetic test systems for the benchmarks
+//
+// Coordinates are written in Å, as the input reader leaves them.
+
+inline void add_atom(Molecule &molecule, std::uint64_t Z, double x, double y, double z)
+{
+    molecule.atomic_numbers.push_back(Z);
+    molecule.atomic_masses.push_back(element_from_z(Z).mass);
+    molecule.coordinates.insert(molecule.coordinates.end(), {x, y, z});
+    ++molecule.natoms;
+}
+
+// Cubic lattice of water molecules with 3 Å spacing
+inline Molecule water_lattice(std::size_t nwaters)
+{
+    const std::size_t side = static_cast<std::size_t>(std::ceil(std::cbrt(static_cast<double>(nwaters))));
+    constexpr double spacing = 3.0;
+
+    Molecule molecule;
+    molecule.natoms = 3 * nwaters;
+
+    std::size_t placed = 0;
+    for (std::size_t i = 0; i < side && placed < nwaters; ++i)
+        for (std::size_t j = 0; j < side && placed < nwaters; ++j)
+            for (std::size_t k = 0; k < side && placed < nwaters; ++k, ++placed)
+            {
+                const double x = spacing * i, y = spacing * j, z = spacing * k;
+
+                molecule.atomic_numbers.insert(molecule.atomic_numbers.end(), {8, 1, 1});
+                molecule.atomic_masses.insert(molecule.atomic_masses.end(), {element_from_z(8).mass, element_from_z(1).mass, element_from_z(1).mass});
+                molecule.coordinates.insert(molecule.coordinates.end(), {x, y, z,
+                                                                         x + 0.757160, y + 0.586260, z,
+                                                                         x - 0.757160, y + 0.586260, z});
+            }
+
+    return molecule;
+}
+
+// All-trans n-alkane CnH2n+2 along x (C-C 1.54 Å, C-H 1.09 Å, tetrahedral
+// angles)
+inline Molecule linear_alkane(std::size_t ncarbons)
+{
+    const double half_angle = 0.5 * 109.47 * std::numbers::pi / 180.0;
+    const double dx = 1.54 * std::sin(half_angle); // along the chain
+    const double dy = 0.5 * 1.54 * std::cos(half_angle);
+
+    // C-H bonds out of the chain plane, pointing away from the chain
+    const double hy = 1.09 * std::cos(half_angle);
+    const double hz = 1.09 * std::sin(half_angle);
+
+    Molecule molecule;
+    for (std::size_t c = 0; c < ncarbons; ++c)
+    {
+        const double x = dx * static_cast<double>(c);
+        const double side = (c % 2) ? 1.0 : -1.0;
+        const double y = side * dy;
+
+        add_atom(molecule, 6, x, y, 0.0);
+        add_atom(molecule, 1, x, y + side * hy, hz);
+        add_atom(molecule, 1, x, y + side * hy, -hz);
+    }
+
+    // Terminal hydrogens continue the zigzag at both ends
+    const double scale = 1.09 / 1.54;
+    add_atom(molecule, 1, -scale * dx, -dy + 2.0 * scale * dy, 0.0);
+
+    const double last_x = dx * static_cast<double>(ncarbons - 1);
+    const double last_side = ((ncarbons - 1) % 2) ? 1.0 : -1.0;
+    add_atom(molecule, 1, last_x + scale * dx, last_side * (dy - 2.0 * scale * dy), 0.0);
+
+    return molecule;
+}
+
+// Hydrogen-terminated graphene flake of nx × ny hexagons in the xy plane
+// (C-C 1.42 Å, C-H 1.09 Å); 1 × 1 is benzene
+inline Molecule graphene_flake(std::size_t nx, std::size_t ny)
+{
+    constexpr double cc = 1.42;
+    constexpr double ch = 1.09;
+    const double sqrt3 = std::sqrt(3.0);
+
+    // Ring vertices, shared between neighbouring rings
+    std::vector<std::array<double, 2>> carbons;
+    for (std::size_t j = 0; j < ny; ++j)
+    {
+        for (std::size_t i = 0; i < nx; ++i)
+        {
+            const double cx = sqrt3 * cc * (static_cast<double>(i) + 0.5 * static_cast<double>(j % 2));
+            const double cy = 1.5 * cc * static_cast<double>(j);
+
+            for (int k = 0; k < 6; ++k)
+            {
+                const double angle = std::numbers::pi / 6.0 + k * std::numbers::pi / 3.0;
+                const std::array<double, 2> p = {cx + cc * std::cos(angle), cy + cc * std::sin(angle)};
+
+                const bool known = std::any_of(carbons.begin(), carbons.end(), [&](const auto &q)
+                                               { return std::hypot(p[0] - q[0], p[1] - q[1]) < 0.1; });
+                if (!known)
+                    carbons.push_back(p);
+            }
+        }
+    }
+
+    Molecule molecule;
+    for (const auto &p : carbons)
+        add_atom(molecule, 6, p[0], p[1], 0.0);
+
+    // Edge carbons have two carbon neighbours; their hydrogen points away
+    // from both
+    for (const auto &p : carbons)
+    {
+        double bx = 0.0, by = 0.0;
+        int neighbours = 0;
+        for (const auto &q : carbons)
+        {
+            const double r = std::hypot(q[0] - p[0], q[1] - p[1]);
+            if (r > 0.1 && r < 1.2 * cc)
+            {
+                bx += q[0] - p[0];
+                by += q[1] - p[1];
+                ++neighbours;
+            }
+        }
+
+        if (neighbours == 2)
+        {
+            const double norm = std::hypot(bx, by);
+            add_atom(molecule, 1, p[0] - ch * bx / norm, p[1] - ch * by / norm, 0.0);
+        }
+    }
+
+    return molecule;
+}
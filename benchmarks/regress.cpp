@@ -0,0 +1,506 @@
+#include "base/base.h"
+#include "basis/basis.h"
+#include "driver/driver.h"
+#include "integrals/nuclear.h"
+#include "integrals/obara-saika/obara-saika.h"
+#include "integrals/shell_pair.h"
+#include "io/io.h"
+#include "io/logging.h"
+#include "lookup/elements.h"
+#include "molecules.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// End-to-end regression harness
+//
+//   planck-regress generate <dir> [--sizes 1,2,4,8,16] [--basis sto-3g,3-21g,6-31g,6-31g*]
+//   planck-regress run <dir> --reference <file> [--update] [--repeat 3]
+//                  [--time-tolerance 0.25] [--time-floor 0.005] [--energy-tolerance 1e-8]
+//                  [--json <results.jsonl>]
+//   planck-regress gradients <dir> [--gradient-tolerance 1e-7]
+//
+// `generate` writes water clusters, linear alkanes and graphene flakes of
+// growing size as input files, one per basis set. `run` takes every input of
+// the directory through the full driver, keeps the best wall time of a few
+// repetitions and compares each job with its reference line: atom and basis
+// function counts must match exactly, the energy within the tolerance, and
+// the wall time may exceed its baseline by at most the relative tolerance
+// (differences under the floor are noise). With --update the reference file
+// is rewritten from this run instead. The exit status is 1 if any job failed
+// or regressed, so the harness can gate a build.
+//
+// The energy compared is the nuclear repulsion energy, the only one the
+// driver produces so far.
+//
+// `gradients` checks the analytic derivative code on every input of the
+// directory against central finite differences: Σ P_μν ∂S_μν/∂R for a random
+// symmetric P, and the nuclear repulsion gradient. Up to 12 Cartesian
+// components per input are checked, spread over the atoms.
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    struct Reference
+    {
+        std::size_t natoms = 0;
+        std::size_t nbf = 0;
+        double energy = 0.0;
+        double wall_seconds = 0.0;
+    };
+
+    struct RunOptions
+    {
+        std::string reference_file;
+        std::string json_file;
+        bool update = false;
+        int repeat = 3;
+        double time_tolerance = 0.25;
+        double time_floor = 0.005;
+        double energy_tolerance = 1e-8;
+        double gradient_tolerance = 1e-7;
+    };
+
+    std::vector<std::string> split_list(const std::string &list)
+    {
+        std::vector<std::string> items;
+        std::stringstream stream(list);
+        for (std::string item; std::getline(stream, item, ',');)
+        {
+            if (!item.empty())
+                items.push_back(item);
+        }
+        return items;
+    }
+
+    // Input file in the format of water.inp
+    bool write_input(const fs::path &filename, const Molecule &molecule, const std::string &basis)
+    {
+        std::ofstream file(filename, std::ios::trunc);
+
+        std::string upper = basis;
+        std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+
+        file << "[CALC]\n"
+             << std::format("BASIS       {}\n", upper)
+             << "CALC_TYPE   ENERGY\n"
+             << "THEORY      RHF\n"
+             << "CHARGE      0\n"
+             << "MULTI       1\n"
+             << "[END CALC]\n\n"
+             << "[GEOM]\n"
+             << molecule.natoms << '\n';
+
+        for (std::size_t a = 0; a < molecule.natoms; ++a)
+        {
+            file << std::format("{:<3} {:>12.6f} {:>12.6f} {:>12.6f}\n", element_from_z(molecule.atomic_numbers[a]).symbol,
+                                molecule.coordinates[3 * a + 0], molecule.coordinates[3 * a + 1], molecule.coordinates[3 * a + 2]);
+        }
+
+        file << "[END GEOM]\n";
+        return static_cast<bool>(file);
+    }
+
+    int generate(const fs::path &directory, const std::vector<std::size_t> &sizes, const std::vector<std::string> &bases)
+    {
+        std::error_code ec;
+        fs::create_directories(directory, ec);
+        if (ec)
+        {
+            std::cerr << std::format("Cannot create {} : {}\n", directory.string(), ec.message());
+            return EXIT_FAILURE;
+        }
+
+        std::size_t written = 0;
+        for (std::size_t size : sizes)
+        {
+            // Flakes grow in both directions: size n gives about n rings
+            const std::size_t nx = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(size))));
+            const std::size_t ny = (size + nx - 1) / nx;
+
+            const std::vector<std::pair<std::string, Molecule>> systems = {
+                {std::format("water-{:03}", size), water_lattice(size)},
+                {std::format("alkane-{:03}", size), linear_alkane(size)},
+                {std::format("graphene-{:03}", nx * ny), graphene_flake(nx, ny)}};
+
+            for (const auto &[name, molecule] : systems)
+            {
+                for (const std::string &basis : bases)
+                {
+                    // '*' is legal in file names but awkward in shells
+                    std::string tag = basis;
+                    std::replace(tag.begin(), tag.end(), '*', 's');
+
+                    const fs::path filename = directory / std::format("{}-{}.inp", name, tag);
+                    if (!write_input(filename, molecule, basis))
+                    {
+                        std::cerr << std::format("Cannot write {}\n", filename.string());
+                        return EXIT_FAILURE;
+                    }
+                    ++written;
+                }
+            }
+        }
+
+        std::cout << std::format("Wrote {} inputs to {}\n", written, directory.string());
+        return EXIT_SUCCESS;
+    }
+
+    // "<input> <natoms> <nbf> <energy> <wall seconds>" per line, '#' comments
+    std::map<std::string, Reference> read_references(const std::string &filename)
+    {
+        std::map<std::string, Reference> references;
+        std::ifstream file(filename);
+        for (std::string line; std::getline(file, line);)
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::istringstream fields(line);
+            std::string input;
+            Reference reference;
+            if (fields >> input >> reference.natoms >> reference.nbf >> reference.energy >> reference.wall_seconds)
+                references[input] = reference;
+        }
+        return references;
+    }
+
+    bool write_references(const std::string &filename, const std::vector<JobResult> &results)
+    {
+        std::ofstream file(filename, std::ios::trunc);
+        file << "# planck-regress reference: input natoms nbf nuclear_repulsion wall_seconds\n";
+        for (const JobResult &result : results)
+        {
+            if (result.success)
+                file << std::format("{} {} {} {:.10f} {:.6f}\n", fs::path(result.input).filename().string(),
+                                    result.natoms, result.nbf, result.nuclear_repulsion, result.wall_seconds);
+        }
+        return static_cast<bool>(file);
+    }
+
+    int run(const fs::path &directory, const RunOptions &options)
+    {
+        auto inputs = Driver::collect_inputs(directory.string());
+        if (!inputs)
+        {
+            std::cerr << inputs.error() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        const auto references = read_references(options.reference_file);
+        if (references.empty() && !options.update)
+            std::cerr << std::format("No references in {}; every job is new\n", options.reference_file);
+
+        // The driver's own messages would drown the table
+        set_logging_enabled(false);
+
+        std::cout << std::format("{:<28} {:>6} {:>6} {:>18} {:>10} {:>10} {:>7}  {}\n",
+                                 "input", "atoms", "nbf", "energy (Eh)", "wall (s)", "base (s)", "ratio", "status");
+
+        std::vector<JobResult> results;
+        std::size_t regressions = 0;
+
+        for (const std::string &input : *inputs)
+        {
+            // Best of a few runs, each with cold caches as in a fresh process
+            JobResult best;
+            for (int r = 0; r < options.repeat; ++r)
+            {
+                SharedCaches caches;
+                JobResult result = Driver::run_job(input, caches, JobMode::Single);
+                if (r == 0 || !result.success || result.wall_seconds < best.wall_seconds)
+                    best = std::move(result);
+                if (!best.success)
+                    break;
+            }
+
+            const std::string name = fs::path(input).filename().string();
+            std::string status = "ok";
+            double baseline = 0.0;
+
+            const auto it = references.find(name);
+            if (!best.success)
+            {
+                status = "failed : " + best.error;
+            }
+            else if (it == references.end())
+            {
+                status = "new";
+            }
+            else
+            {
+                const Reference &reference = it->second;
+                baseline = reference.wall_seconds;
+                const double excess = best.wall_seconds - baseline;
+
+                if (best.natoms != reference.natoms || best.nbf != reference.nbf)
+                    status = std::format("changed : {} atoms, {} functions in the reference", reference.natoms, reference.nbf);
+                else if (std::abs(best.nuclear_repulsion - reference.energy) > options.energy_tolerance)
+                    status = std::format("energy : {:.10f} in the reference", reference.energy);
+                else if (excess > options.time_tolerance * baseline && excess > options.time_floor)
+                    status = "slower";
+                else if (-excess > options.time_tolerance * baseline && -excess > options.time_floor)
+                    status = "faster";
+            }
+
+            // In update mode only failures count; the rest becomes the reference
+            const bool regressed = !best.success || (!options.update && status != "ok" && status != "new" && status != "faster");
+            if (regressed)
+                ++regressions;
+
+            std::cout << std::format("{:<28} {:>6} {:>6} {:>18.10f} {:>10.4f} {:>10.4f} {:>7.2f}  {}\n",
+                                     name, best.natoms, best.nbf, best.nuclear_repulsion, best.wall_seconds, baseline,
+                                     baseline > 0.0 ? best.wall_seconds / baseline : 0.0, status);
+
+            results.push_back(std::move(best));
+        }
+
+        if (!options.json_file.empty())
+        {
+            std::ofstream records(options.json_file, std::ios::trunc);
+            for (const JobResult &result : results)
+                records << Driver::to_json(result) << '\n';
+        }
+
+        if (options.update)
+        {
+            if (!write_references(options.reference_file, results))
+            {
+                std::cerr << std::format("Cannot write {}\n", options.reference_file);
+                return EXIT_FAILURE;
+            }
+            std::cout << std::format("Updated {}\n", options.reference_file);
+        }
+
+        std::cout << std::format("{} of {} jobs {}\n", regressions, results.size(), options.update ? "failed" : "failed or regressed");
+        return regressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Largest deviation of the analytic derivatives from central differences
+    // over the checked components, for Σ P ∂S/∂R and for the nuclear repulsion
+    struct GradientCheck
+    {
+        std::size_t components = 0;
+        double overlap_error = 0.0;
+        double nuclear_error = 0.0;
+    };
+
+    GradientCheck check_gradients(const Molecule &molecule, const std::string &gbs_file, ShellType shell_type)
+    {
+        constexpr double step = 1e-5; // Å
+        constexpr std::size_t max_components = 12;
+
+        auto overlap_basis = [&](const Molecule &m)
+        { return read_gbs_basis(gbs_file, m, shell_type); };
+
+        const Basis basis = overlap_basis(molecule);
+        const std::size_t nbf = basis.nbf();
+
+        // Fixed seed, so a failure can be reproduced
+        std::mt19937 generator(2024);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+        std::vector<double> P(nbf * nbf);
+        for (std::size_t i = 0; i < nbf; ++i)
+            for (std::size_t j = 0; j <= i; ++j)
+                P[i * nbf + j] = P[j * nbf + i] = uniform(generator);
+
+        const ShellPairList shell_pairs = build_shell_pairs(basis);
+        const auto overlap_gradient = ObaraSaika::Overlap::computeOverlapGradient(basis, shell_pairs, P, molecule.natoms, BatchDistribution::Local);
+        const auto nuclear_gradient = nuclear_repulsion_gradient(molecule);
+
+        auto contracted_overlap = [&](const Molecule &m)
+        {
+            const auto S = ObaraSaika::Overlap::computeOverlap(overlap_basis(m), BatchDistribution::Local);
+            double sum = 0.0;
+            for (std::size_t i = 0; i < S.size(); ++i)
+                sum += P[i] * S[i];
+            return sum;
+        };
+
+        GradientCheck check;
+        const std::size_t ncoords = 3 * molecule.natoms;
+        const std::size_t stride = std::max<std::size_t>(1, ncoords / max_components);
+
+        for (std::size_t k = 0; k < ncoords && check.components < max_components; k += stride, ++check.components)
+        {
+            Molecule plus = molecule, minus = molecule;
+            plus.coordinates[k] += step;
+            minus.coordinates[k] -= step;
+
+            // Gradients are per bohr, coordinates in Å
+            const double h = 2.0 * step * ANGSTROM_TO_BOHR;
+            const double overlap_fd = (contracted_overlap(plus) - contracted_overlap(minus)) / h;
+            const double nuclear_fd = (nuclear_repulsion_energy(plus) - nuclear_repulsion_energy(minus)) / h;
+
+            check.overlap_error = std::max(check.overlap_error, std::abs(overlap_fd - overlap_gradient[k]) / std::max(1.0, std::abs(overlap_fd)));
+            check.nuclear_error = std::max(check.nuclear_error, std::abs(nuclear_fd - nuclear_gradient[k]) / std::max(1.0, std::abs(nuclear_fd)));
+        }
+
+        return check;
+    }
+
+    int gradients(const fs::path &directory, const RunOptions &options)
+    {
+        auto inputs = Driver::collect_inputs(directory.string());
+        if (!inputs)
+        {
+            std::cerr << inputs.error() << '\n';
+            return EXIT_FAILURE;
+        }
+
+        set_logging_enabled(false);
+
+        std::cout << std::format("{:<28} {:>6} {:>10} {:>14} {:>14}  {}\n", "input", "atoms", "checked", "overlap err", "nuclear err", "status");
+
+        std::size_t failures = 0;
+        for (const std::string &input : *inputs)
+        {
+            const std::string name = fs::path(input).filename().string();
+
+            Calculator calculator;
+            Molecule molecule;
+            if (auto read = read_input_file(input, calculator, molecule); !read)
+            {
+                std::cout << std::format("{:<28} {:>6} {:>10} {:>14} {:>14}  failed : {}\n", name, "", "", "", "", read.error());
+                ++failures;
+                continue;
+            }
+
+            const ShellType shell_type = calculator.basis_type == "spherical" ? ShellType::Spherical : ShellType::Cartesian;
+
+            std::string status = "ok";
+            GradientCheck check;
+            try
+            {
+                check = check_gradients(molecule, calculator.basis_path + "/" + calculator.basis_name, shell_type);
+                if (check.overlap_error > options.gradient_tolerance || check.nuclear_error > options.gradient_tolerance)
+                    status = "mismatch";
+            }
+            catch (const std::exception &e)
+            {
+                status = std::string("failed : ") + e.what();
+            }
+
+            if (status != "ok")
+                ++failures;
+
+            std::cout << std::format("{:<28} {:>6} {:>10} {:>14.2e} {:>14.2e}  {}\n", name, molecule.natoms, check.components,
+                                     check.overlap_error, check.nuclear_error, status);
+        }
+
+        std::cout << std::format("{} of {} inputs failed\n", failures, inputs->size());
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    void usage(const char *program)
+    {
+        std::cerr << std::format("Usage: {} generate <dir> [--sizes 1,2,4,8,16] [--basis sto-3g,3-21g,6-31g,6-31g*]\n", program)
+                  << std::format("       {} run <dir> --reference <file> [--update] [--repeat n] [--time-tolerance r]\n", program)
+                  << "                 [--time-floor seconds] [--energy-tolerance Eh] [--json <results.jsonl>]\n"
+                  << std::format("       {} gradients <dir> [--gradient-tolerance t]\n", program);
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 3)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::string command = argv[1];
+    const fs::path directory = argv[2];
+
+    std::vector<std::size_t> sizes = {1, 2, 4, 8, 16};
+    std::vector<std::string> bases = {"sto-3g", "3-21g", "6-31g", "6-31g*"};
+    RunOptions options;
+
+    try
+    {
+        for (int arg = 3; arg < argc; ++arg)
+        {
+            const std::string option = argv[arg];
+            if (option == "--update")
+            {
+                options.update = true;
+                continue;
+            }
+
+            if (arg + 1 >= argc)
+                throw std::invalid_argument(option + " needs a value");
+            const std::string value = argv[++arg];
+
+            if (option == "--sizes")
+            {
+                sizes.clear();
+                for (const std::string &size : split_list(value))
+                    sizes.push_back(std::stoul(size));
+            }
+            else if (option == "--basis")
+                bases = split_list(value);
+            else if (option == "--reference")
+                options.reference_file = value;
+            else if (option == "--json")
+                options.json_file = value;
+            else if (option == "--repeat")
+                options.repeat = std::max(1, std::stoi(value));
+            else if (option == "--time-tolerance")
+                options.time_tolerance = std::stod(value);
+            else if (option == "--time-floor")
+                options.time_floor = std::stod(value);
+            else if (option == "--energy-tolerance")
+                options.energy_tolerance = std::stod(value);
+            else if (option == "--gradient-tolerance")
+                options.gradient_tolerance = std::stod(value);
+            else
+                throw std::invalid_argument("Unknown option " + option);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << '\n';
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (command == "generate")
+        return generate(directory, sizes, bases);
+
+    if (command == "run" && !options.reference_file.empty())
+        return run(directory, options);
+
+    if (command == "gradients")
+        return gradients(directory, options);
+
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,83 @@
+#include "base/base.h"
+#include "base/basis.h"
+#include "basis/basis.h"
+#include "integrals/obara-saika/obara-saika.h"
+#include "molecules.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Strong-scaling benchmark for the one-electron matrix builders
+//
+// Usage: planck-scaling [n_waters] [basis] [max_threads]
+// A cubic lattice of water molecules (3 Å spacing) is built with a fixed
+// basis, and computeOverlap is timed for 1, 2, 4, ... max_threads threads.
+
+int main(int argc, const char *argv[])
+{
+    const std::size_t nwaters = (argc > 1) ? std::stoul(argv[1]) : 32;
+    const std::string basis_name = (argc > 2) ? argv[2] : "6-31g*";
+    const int max_threads = (argc > 3) ? std::stoi(argv[3]) : 64;
+    constexpr int repeats = 3;
+
+    const Molecule molecule = water_lattice(nwaters);
+    const Basis basis = read_gbs_basis(get_basis_path() + "/" + basis_name, molecule, ShellType::Cartesian);
+
+    std::cout << std::format("# {} waters, {} : {} shells, {} functions\n", nwaters, basis_name, basis.nshells(), basis.nbf());
+    std::cout << std::format("# {:>8} {:>14} {:>10} {:>12}\n", "threads", "overlap (s)", "speedup", "efficiency");
+
+    double serial_time = 0.0;
+    for (int threads = 1; threads <= max_threads; threads *= 2)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#else
+        if (threads > 1)
+            break;
+#endif
+
+        // best of several repetitions
+        double best = 1e300;
+        for (int r = 0; r < repeats; ++r)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const auto S = ObaraSaika::Overlap::computeOverlap(basis);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+
+        if (threads == 1)
+            serial_time = best;
+
+        const double speedup = serial_time / best;
+        std::cout << std::format("  {:>8} {:>14.6f} {:>10.2f} {:>12.2f}\n", threads, best, speedup, speedup / threads);
+    }
+
+    return EXIT_SUCCESS;
+}
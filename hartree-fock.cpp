@@ -1,18 +1,22 @@
 #include "base/base.h"
-#include "io/io.h"
 #include "io/logging.h"
-#include "basis/basis.h"
-#include "symmetry/symmetry.h"
+#include "driver/driver.h"
+#include "driver/server.h"
+#include "parallel/distributed.h"
+#include "parallel/task_pool.h"
+#include "profile/counters.h"
+#include "profile/hardware.h"
+#include "profile/timers.h"
 
 #include <chrono>
+#include <expected>
 #include <iostream>
 #include <filesystem>
-#include <fstream>
 #include <format>
 #include <iomanip>
 #include <sstream>
 #include <string>
-#include <sstream>
+#include <string_view>
 
 /*-----------------------------------------------------------------------------
  * Planck
@@ -50,131 +54,212 @@ static std::string format_time(SystemClock::time_point tp)
     return os.str();
 }
 
+// --batch, --serve and --submit select the mode and end the options
+static bool is_mode(std::string_view arg)
+{
+    return arg == "--batch" || arg == "--serve" || arg == "--submit";
+}
+
+// Options that come before the input: --log-level <level>, --log-json <file>,
+// --trace <file>, --hw-counters. Returns the index of the first argument after them.
+static std::expected<int, std::string> parse_options(int argc, const char *argv[], std::string &trace_file)
+{
+    int arg = 1;
+    while (arg < argc && std::string_view(argv[arg]).starts_with("--") && !is_mode(argv[arg]))
+    {
+        const std::string_view option = argv[arg];
+
+        // Flags without a value
+        if (option == "--hw-counters")
+        {
+            // Counting is optional: without counters the run goes on untimed by them
+            if (auto events = Profile::enable_hardware_counters())
+                logging(LogLevel::Info, "Hardware Counters :", *events);
+            else
+                logging(LogLevel::Info, "Hardware Counters :", "unavailable, " + events.error());
+
+            ++arg;
+            continue;
+        }
+
+        if (arg + 1 >= argc)
+            return std::unexpected(std::format("{} needs a value", option));
+
+        const std::string value = argv[arg + 1];
+
+        if (option == "--log-level")
+        {
+            auto level = log_level_from_string(value);
+            if (!level)
+                return std::unexpected(level.error());
+            set_log_level(*level);
+        }
+        else if (option == "--log-json")
+        {
+            // one file per MPI rank, as for batch results
+            const int rank = Distributed::rank();
+            auto opened = open_json_log(rank == 0 ? value : std::format("{}.{}", value, rank));
+            if (!opened)
+                return std::unexpected(opened.error());
+        }
+        else if (option == "--trace")
+        {
+            const int rank = Distributed::rank();
+            trace_file = rank == 0 ? value : std::format("{}.{}", value, rank);
+            Profile::enable_tracing();
+        }
+        else
+        {
+            return std::unexpected(std::format("Unknown option {}", option));
+        }
+
+        arg += 2;
+    }
+
+    return arg;
+}
+
 int main(int argc, const char *argv[])
 {
     const auto program_start = SystemClock::now();
 
+    // Every rank runs the full driver on replicated data; only rank 0 reports
+    MpiSession mpi_session;
+    set_logging_enabled(Distributed::rank() == 0);
+
+    std::string trace_file;
+    const auto first_arg = parse_options(argc, argv, trace_file);
+
+    const int nargs = first_arg ? argc - *first_arg : 0;
+    const char **args = argv + (first_arg ? *first_arg : argc);
+
+    const bool batch_mode = (nargs == 2 || nargs == 3) && std::string(args[0]) == "--batch";
+    const bool serve_mode = nargs == 2 && std::string(args[0]) == "--serve";
+    const bool submit_mode = nargs == 3 && std::string(args[0]) == "--submit";
+
+    // A client prints nothing but the server's reply
+    if (submit_mode)
+        set_logging_enabled(false);
+
     logging(LogLevel::Info, "Program Started On :", format_time(program_start));
     logging(LogLevel::Info, "Current Working Directory :", fs::current_path().string());
 
-    if (argc != 2)
+    if (!first_arg || (nargs != 1 && !batch_mode && !serve_mode && !submit_mode))
     {
-        logging(LogLevel::Error, "Usage :", std::format("{} <input file>", argv[0]));
+        if (!first_arg)
+            logging(LogLevel::Error, "Option Error :", first_arg.error());
+
+        logging(LogLevel::Error, "Usage :", std::format("{} [options] <input file>", argv[0]));
+        logging(LogLevel::Error, "", std::format("{} [options] --batch <list file | directory> [results.jsonl]", argv[0]));
+        logging(LogLevel::Error, "", std::format("{} [options] --serve <socket>", argv[0]));
+        logging(LogLevel::Error, "", std::format("{} --submit <socket> <input file | SHUTDOWN>", argv[0]));
+        logging(LogLevel::Error, "Options :", "--log-level <trace | debug | info | error>, --log-json <file.jsonl>, --trace <file.json>, --hw-counters");
         return EXIT_FAILURE;
     }
 
-    const std::string input_file = argv[1];
-    std::ifstream input_stream(input_file);
-    if (!input_stream)
+    // A trace is written when the process ends, and a server would keep the
+    // events of every job in memory until then
+    if (serve_mode && !trace_file.empty())
     {
-        logging(LogLevel::Error, "Input Error :", "Failed to open input file");
+        logging(LogLevel::Error, "Option Error :", "--trace cannot be used with --serve");
         return EXIT_FAILURE;
     }
 
-    // Core objects
-    Calculator calculator{};
-    Molecule molecule{};
-
-    // Parse input
-    if (auto res = read_input(input_stream, calculator, molecule); !res)
+    if (submit_mode)
     {
-        logging(LogLevel::Error, "Input Parsing Failed :", res.error());
-        return EXIT_FAILURE;
+        auto succeeded = Driver::submit(args[1], args[2]);
+        if (!succeeded)
+            logging(LogLevel::Error, "Submit Error :", succeeded.error());
+
+        return (succeeded && *succeeded) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
-    logging(LogLevel::Info, "Input Parsing :", "Successful");
+    // Parsed basis files are reused by every job of this process
+    SharedCaches caches;
+    int status = EXIT_SUCCESS;
 
-    // Now log all input options
-    logging(LogLevel::Info, "Calculation Type :", calculator.calc_type);
-    logging(LogLevel::Info, "Theory :", calculator.method);
-    logging(LogLevel::Info, "Basis :", calculator.basis_name);
+    // Phase timings go next to the input (or the batch results)
+    std::string timing_report;
 
-    // Detect Symmetry
-    if (!calculator.use_pgsymmetry)
+    if (batch_mode)
     {
-        logging(LogLevel::Info, "Symmetry Detection :", "Symmetry detection is turned off by request");
-    }
-
-    logging(LogLevel::Info, "Symmetry Detection :", "We use libmsym library to detect point groups");
+        auto inputs = Driver::collect_inputs(args[1]);
+        if (!inputs)
+        {
+            logging(LogLevel::Error, "Batch Error :", inputs.error());
+            return EXIT_FAILURE;
+        }
 
-    if (auto res = detectSymmetry(molecule); !res)
-    {
-        logging(LogLevel::Error, "Symmetry Detection Failed :", res.error());
-        return EXIT_FAILURE;
-    }
+        const std::string results_file = (nargs == 3) ? args[2] : "planck_batch.jsonl";
+        logging(LogLevel::Info, "Batch Mode :", std::format("{} inputs on {} threads", inputs->size(), TaskPool::max_threads()));
+        logging(LogLevel::Info, "Batch Results :", results_file);
 
-    logging(LogLevel::Info, "Symmetry Detection :", "Successful");
-    logging(LogLevel::Info, "Point Group :", molecule.point_group);
+        // every rank runs its own jobs, so every rank reports
+        timing_report = fs::path(results_file).replace_extension(".timings.json").string();
+        if (Distributed::rank() > 0)
+            timing_report += std::format(".{}", Distributed::rank());
 
-    logging(LogLevel::Info, "Input Coordinates :", "");
+        auto failed = Driver::run_batch(*inputs, results_file, caches);
+        if (!failed)
+        {
+            logging(LogLevel::Error, "Batch Error :", failed.error());
+            return EXIT_FAILURE;
+        }
 
-    // get input coordinates
-    for (std::size_t index = 0; index < molecule.natoms; ++index)
+        // Failed jobs are recorded in the results file and do not fail the batch
+        logging(LogLevel::Info, "Batch Summary :", std::format("{} failed on this rank", *failed));
+    }
+    else if (serve_mode)
     {
-        std::string cstr;
-        std::ostringstream astream;
-        astream << std::setw(5) << std::right << molecule.atomic_numbers[index];
-        cstr += astream.str();
-
-        for (std::size_t cindex = 0; cindex < 3; ++cindex)
+        // Requests arrive one at a time; collectives across ranks would need all of them
+        if (Distributed::size() > 1)
         {
-            std::ostringstream oss;
-            oss << std::setw(10) << std::setprecision(3) << std::fixed << molecule.coordinates[3 * index + cindex];
-            cstr += oss.str();
+            logging(LogLevel::Error, "Server Error :", "Server mode runs on a single rank");
+            return EXIT_FAILURE;
         }
-        logging(LogLevel::Info, "", cstr);
-    }
 
-    // get reoriented coordinates
-    if (molecule.is_reoriented)
-    {
-        logging(LogLevel::Info, "Standard Coordinates :", "");
-        for (std::size_t index = 0; index < molecule.natoms; ++index)
+        // Phases summed over every request served
+        timing_report = std::string(args[1]) + ".timings.json";
+
+        auto served = Driver::serve(args[1], caches);
+        if (!served)
         {
-            std::string cstr;
-            std::ostringstream astream;
-            astream << std::setw(5) << std::right << molecule.atomic_numbers[index];
-            cstr += astream.str();
-
-            for (std::size_t cindex = 0; cindex < 3; ++cindex)
-            {
-                std::ostringstream oss;
-                oss << std::setw(10) << std::setprecision(3) << std::fixed << molecule.coordinates_standard[3 * index + cindex];
-                cstr += oss.str();
-            }
-            logging(LogLevel::Info, "", cstr);
+            logging(LogLevel::Error, "Server Error :", served.error());
+            return EXIT_FAILURE;
         }
     }
-
-    if (calculator.basis_name.empty())
+    else
     {
-        logging(LogLevel::Error, "Basis Error :", "No basis set file specified");
-        return EXIT_FAILURE;
-    }
-
-    // Parse basis sets
-    const fs::path gbs_path = calculator.basis_path + "/" + calculator.basis_name;
-    logging(LogLevel::Info, "Reading Basis Set :", gbs_path.string());
+        const JobResult result = Driver::run_job(args[0], caches, JobMode::Single);
+        status = result.success ? EXIT_SUCCESS : EXIT_FAILURE;
 
-    Basis basis;
+        if (Distributed::rank() == 0)
+            timing_report = fs::path(args[0]).replace_extension(".timings.json").string();
+    }
 
-    try
+    if (!timing_report.empty())
     {
-        ShellType shell_type = calculator.basis_type.compare("cartesian") == 0 ? ShellType::Cartesian : ShellType::Spherical;
-        basis = read_gbs_basis(gbs_path, molecule, shell_type); // cartesian or pure
+        if (auto written = Profile::write_timer_report(timing_report))
+            logging(LogLevel::Info, "Timing Report :", timing_report);
+        else
+            logging(LogLevel::Error, "Timing Report :", written.error());
     }
-    catch (const std::exception &e)
+
+    if (!trace_file.empty())
     {
-        logging(LogLevel::Error, "Basis Parsing Failed :", e.what());
-        return EXIT_FAILURE;
+        if (auto written = Profile::write_trace(trace_file, Distributed::rank()))
+            logging(LogLevel::Info, "Trace :", trace_file);
+        else
+            logging(LogLevel::Error, "Trace :", written.error());
     }
 
-    logging(LogLevel::Info, "Basis Construction :", std::format("Generated {} Shells and {} contracted functions", basis.nshells(), basis.nbf()));
+    if constexpr (Profile::counters_enabled())
+        Profile::log_counter_summary();
 
     const auto program_end = SystemClock::now();
     const std::chrono::duration<double> elapsed = program_end - program_start;
 
     logging(LogLevel::Info, "Total Wall Time :", std::format("{:.6f} seconds", elapsed.count()));
 
-    return EXIT_SUCCESS;
+    return status;
 }
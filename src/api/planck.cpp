@@ -0,0 +1,113 @@
+#include "planck.h"
+#include "integrals/nuclear.h"
+#include "integrals/obara-saika/obara-saika.h"
+#include "integrals/shell_pair.h"
+#include "io/logging.h"
+#include "lookup/elements.h"
+#include "symmetry/symmetry.h"
+
+#include <exception>
+#include <format>
+#include <utility>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+std::expected<Molecule, std::string> Planck::make_molecule(std::span<const std::uint64_t> atomic_numbers, std::span<const double> coordinates)
+{
+    if (coordinates.size() != 3 * atomic_numbers.size())
+        return std::unexpected(std::format("{} coordinates for {} atoms", coordinates.size(), atomic_numbers.size()));
+
+    Molecule molecule;
+    molecule.natoms = atomic_numbers.size();
+    molecule.atomic_numbers.assign(atomic_numbers.begin(), atomic_numbers.end());
+    molecule.coordinates.assign(coordinates.begin(), coordinates.end());
+
+    try
+    {
+        for (std::uint64_t Z : atomic_numbers)
+            molecule.atomic_masses.push_back(element_from_z(Z).mass);
+    }
+    catch (const std::exception &e)
+    {
+        return std::unexpected(e.what());
+    }
+
+    return molecule;
+}
+
+Planck::Session::Session(Options options) : options_(std::move(options)) {}
+
+std::expected<Basis, std::string> Planck::Session::basis(const Molecule &molecule, const std::string &basis_name, ShellType shell_type)
+{
+    // Only messages of this call; errors still reach stderr
+    const QuietConsole quiet(!options_.log_to_stdout);
+
+    try
+    {
+        return library_.build(options_.basis_path + "/" + basis_name, molecule, shell_type);
+    }
+    catch (const std::exception &e)
+    {
+        return std::unexpected(e.what());
+    }
+}
+
+std::expected<Basis, std::string> Planck::Session::basis(const Molecule &molecule, const BasisSet &basis_set, ShellType shell_type)
+{
+    const QuietConsole quiet(!options_.log_to_stdout);
+
+    try
+    {
+        return build_basis(basis_set, molecule, shell_type);
+    }
+    catch (const std::exception &e)
+    {
+        return std::unexpected(e.what());
+    }
+}
+
+std::expected<Planck::Result, std::string> Planck::Session::run(const Molecule &molecule, Basis basis)
+{
+    const QuietConsole quiet(!options_.log_to_stdout);
+
+    Result result;
+
+    try
+    {
+        if (options_.detect_symmetry)
+        {
+            Molecule oriented = molecule;
+            if (auto res = detectSymmetry(oriented); !res)
+                return std::unexpected("Symmetry Detection Failed : " + res.error());
+            result.point_group_ = oriented.point_group;
+        }
+
+        result.nuclear_repulsion_ = nuclear_repulsion_energy(molecule);
+
+        // The calling process owns MPI, if any; a session computes locally
+        const ShellPairList shell_pairs = build_shell_pairs(basis);
+        result.overlap_ = ObaraSaika::Overlap::computeOverlap(basis, shell_pairs, BatchDistribution::Local);
+        result.basis_ = std::move(basis);
+    }
+    catch (const std::exception &e)
+    {
+        return std::unexpected(e.what());
+    }
+
+    return result;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/basis.h"
+#include "basis/basis.h"
+#include "basis/library.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// In-process C++ API of the planck library
+//
+// For programs that run many small calculations and cannot afford a process
+// and an input file per calculation:
+//
+//     Planck::Session session;
+//     auto molecule = Planck::make_molecule(atomic_numbers, coordinates);
+//     auto basis = session.basis(*molecule, "6-31g*");
+//     auto result = session.run(*molecule, std::move(*basis));
+//     std::span<const double> S = result->overlap();
+//
+// A session keeps the basis set files it has read, so only its first
+// calculation touches the disk; a basis set can also be handed over already
+// parsed. Nothing is written to files, and the informational messages of a
+// session's calls stay off stdout unless asked for, without silencing the
+// rest of the process. Calculations on one session run one at a time, each
+// using the whole thread pool.
+//
+// The driver has no SCF yet: a result holds what the pipeline computes so
+// far (point group, basis, overlap matrix, nuclear repulsion energy).
+namespace Planck
+{
+    // Molecule from atomic numbers and Cartesian coordinates in Å
+    // (x0, y0, z0, x1, ...), with masses from the element table
+    std::expected<Molecule, std::string> make_molecule(std::span<const std::uint64_t> atomic_numbers, std::span<const double> coordinates);
+
+    struct Options
+    {
+        std::string basis_path = get_basis_path(); // directory of the .gbs files
+        bool detect_symmetry = true;
+        bool log_to_stdout = false; // informational messages of this session's calls
+    };
+
+    // Outcome of one calculation; matrices are row-major nbf × nbf
+    class Result
+    {
+    public:
+        const std::string &point_group() const noexcept { return point_group_; }
+        double nuclear_repulsion() const noexcept { return nuclear_repulsion_; }
+
+        const Basis &basis() const noexcept { return basis_; }
+        std::size_t nbf() const noexcept { return basis_.nbf(); }
+
+        std::span<const double> overlap() const noexcept { return overlap_; }
+
+    private:
+        friend class Session;
+
+        std::string point_group_;
+        double nuclear_repulsion_ = 0.0;
+        Basis basis_;
+        std::vector<double> overlap_;
+    };
+
+    class Session
+    {
+    public:
+        explicit Session(Options options = {});
+
+        Session(const Session &) = delete;
+        Session &operator=(const Session &) = delete;
+
+        // Basis from the file `basis_name` ("6-31g*") in options.basis_path,
+        // read once per session
+        std::expected<Basis, std::string> basis(const Molecule &molecule, const std::string &basis_name, ShellType shell_type = ShellType::Cartesian);
+
+        // Basis from a basis set already in memory
+        std::expected<Basis, std::string> basis(const Molecule &molecule, const BasisSet &basis_set, ShellType shell_type = ShellType::Cartesian);
+
+        // Everything the pipeline computes for `molecule` in `basis`
+        std::expected<Result, std::string> run(const Molecule &molecule, Basis basis);
+
+    private:
+        Options options_;
+        BasisLibrary library_;
+    };
+};
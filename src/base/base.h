@@ -3,6 +3,7 @@
 #include <array>
 #include <cstdint>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <span>
 
@@ -35,6 +36,9 @@ struct Molecule
     std::vector<double> coordinates;
     std::vector<double> coordinates_standard;
 
+    // Geometries of a scan (same atoms in the same order), frame 0 first
+    std::vector<std::vector<double>> scan_frames;
+
     std::string point_group;
     bool is_reoriented = false;
 
@@ -44,65 +48,99 @@ struct Molecule
         atomic_numbers.clear();
         atomic_masses.clear();
         coordinates.clear();
+        scan_frames.clear();
     }
 };
 
+// Normalized primitives of one contracted shell of one element, as a range of
+// the Basis primitive arena. Built once per element and shared by all atoms of
+// that element, so anything that depends only on the primitives can be
+// computed per template.
+struct ShellTemplate
+{
+    std::uint64_t Z = 0; // element
+    int L = 0;
+
+    std::size_t first_primitive = 0;
+    std::size_t primitive_count = 0;
+};
+
 struct Shell
 {
     // Center in BOHR
     std::array<double, 3> center{};
 
+    // Index of the atom it sits on (gradients sort contributions by atom)
+    std::size_t atom = 0;
+
     // Total angular momentum (L = lx + ly + lz)
     int L = 0;
 
-    // Primitive data (SoA layout)
-    std::vector<double> exponents;    // α_i
-    std::vector<double> coefficients; // c_i
-    std::vector<double> prim_norms;   // primitive normalization constants
-
-    std::size_t nprimitives() const noexcept
-    {
-        return exponents.size();
-    }
-};
+    // Real solid-harmonic (pure) functions instead of Cartesian ones
+    bool pure = false;
 
-struct ContractedView
-{
-    // Pointer to owning shell (non-owning, stable lifetime)
-    const Shell *shell = nullptr;
+    // Index of the shared template in Basis::templates; kernels can key
+    // per-element caches on it
+    std::size_t template_index = 0;
 
-    // Cartesian angular momentum component (lx, ly, lz)
-    std::array<int, 3> am{};
+    // Range of the Basis primitive arena (copied from the template)
+    std::size_t first_primitive = 0;
+    std::size_t primitive_count = 0;
 
-    // Convenience accessors
-    std::span<const double> exponents() const noexcept
+    std::size_t nprimitives() const noexcept
     {
-        return shell->exponents;
+        return primitive_count;
     }
 
-    std::span<const double> coefficients() const noexcept
+    std::size_t ncartesian() const noexcept
     {
-        return shell->coefficients;
+        return static_cast<std::size_t>((L + 1) * (L + 2) / 2);
     }
 
-    std::span<const double> primitive_norms() const noexcept
+    // Number of contracted functions this shell contributes to the basis
+    std::size_t nfunctions() const noexcept
     {
-        return shell->prim_norms;
+        return pure ? static_cast<std::size_t>(2 * L + 1) : ncartesian();
     }
+};
 
-    const std::array<double, 3> &center() const noexcept
-    {
-        return shell->center;
-    }
+// One contracted basis function
+struct BasisFunction
+{
+    // Index of the owning shell in Basis::shells
+    std::size_t shell = 0;
+
+    // Cartesian angular momentum component (lx, ly, lz)
+    std::array<int, 3> am{};
+
+    // Real solid-harmonic component (pure shells only)
+    int m = 0;
 };
 
+// Records refer to each other by index only, so a Basis can be copied, moved,
+// grown or written out array by array without fixing up anything
+static_assert(std::is_trivially_copyable_v<ShellTemplate>);
+static_assert(std::is_trivially_copyable_v<Shell>);
+static_assert(std::is_trivially_copyable_v<BasisFunction>);
+
 struct Basis
 {
-    // Owns shells
+    // Primitive arena (SoA layout), one entry per primitive of every template
+    std::vector<double> primitive_exponents;    // α_i
+    std::vector<double> primitive_coefficients; // c_i, contraction normalization included
+    std::vector<double> primitive_norms;        // primitive normalization constants
+
+    // One entry per (element, shell)
+    std::vector<ShellTemplate> templates;
+
+    // Shells placed on the atoms
     std::vector<Shell> shells;
 
-    // Lightweight contracted-function views
-    std::vector<ContractedView> functions;
+    // Contracted functions, shell by shell
+    std::vector<BasisFunction> functions;
+
+    // Index of the first function of each shell
+    std::vector<std::size_t> shell_offsets;
 
     std::size_t nshells() const noexcept
     {
@@ -114,10 +152,31 @@ struct Basis
         return functions.size();
     }
 
+    // Primitive data of a shell (views into the arena)
+    std::span<const double> exponents(const Shell &shell) const noexcept
+    {
+        return {primitive_exponents.data() + shell.first_primitive, shell.primitive_count};
+    }
+
+    std::span<const double> coefficients(const Shell &shell) const noexcept
+    {
+        return {primitive_coefficients.data() + shell.first_primitive, shell.primitive_count};
+    }
+
+    std::span<const double> prim_norms(const Shell &shell) const noexcept
+    {
+        return {primitive_norms.data() + shell.first_primitive, shell.primitive_count};
+    }
+
     void clear()
     {
+        primitive_exponents.clear();
+        primitive_coefficients.clear();
+        primitive_norms.clear();
+        templates.clear();
         shells.clear();
         functions.clear();
+        shell_offsets.clear();
     }
 };
 
@@ -128,6 +187,22 @@ enum IntegralEngine
     OS
 };
 
+// Placement of large buffers over NUMA nodes
+enum class NumaPolicy
+{
+    Off,        // serial initialization, pages follow the master thread
+    FirstTouch, // parallel first-touch initialization
+    Interleave  // pages interleaved over all nodes
+};
+
+// How task batches are handed to MPI ranks
+enum class BatchDistribution
+{
+    RoundRobin, // static, rank r takes every n-th batch
+    Dynamic,    // claimed from a shared counter
+    Local       // all batches on this rank, no MPI communication (batch jobs)
+};
+
 struct Calculator
 {
     // Input
@@ -136,9 +211,12 @@ struct Calculator
     std::string method;
     std::string calc_type;  // calculation type
     std::string coord_type; // cartesian / z-matrix
-    std::string basis_type; // cartesian / spherical
+    std::string basis_type = "cartesian"; // cartesian / spherical
+    std::string scan_file;                // multi-frame XYZ file for scans
 
     IntegralEngine integral_engine = IntegralEngine::OS;
+    BatchDistribution batch_distribution = BatchDistribution::Dynamic;
+    NumaPolicy numa_policy = NumaPolicy::FirstTouch;
 
     int max_iter = 50;
     int max_scf = 50;
@@ -16,6 +16,9 @@
  ----------------------------------------------------------------------------*/
 
 #include "basis.h"
+#include "math/math.h"
+
+#include <cstdlib>
 
 int shell_label_to_L(const std::string &label)
 {
@@ -52,11 +55,122 @@ std::vector<std::array<int, 3>> cartesian_shell_order(int L)
     return result;
 }
 
+std::vector<int> spherical_shell_order(int L)
+{
+    std::vector<int> result;
+    result.reserve(2 * L + 1);
+
+    for (int m = -L; m <= L; ++m)
+        result.push_back(m);
+
+    return result;
+}
+
+namespace
+{
+    double factorial(int n)
+    {
+        double result = 1.0;
+        for (int i = 2; i <= n; ++i)
+            result *= i;
+        return result;
+    }
+
+    double binomial(int n, int k)
+    {
+        if (k < 0 || k > n)
+            return 0.0;
+        return factorial(n) / (factorial(k) * factorial(n - k));
+    }
+
+    int parity(int i)
+    {
+        return (i % 2) ? -1 : 1;
+    }
+
+    // Coefficient of x^lx y^ly z^lz in the real solid harmonic S(L, m), for
+    // Cartesian functions that all carry the normalization of x^L.
+    // Schlegel & Frisch, Int. J. Quantum Chem. 54, 83 (1995), eq. 15
+    double solid_harmonic_coefficient(int L, int m, int lx, int ly, int lz)
+    {
+        const int abs_m = std::abs(m);
+        if ((lx + ly - abs_m) % 2 != 0)
+            return 0.0;
+
+        const int j = (lx + ly - abs_m) / 2;
+        if (j < 0)
+            return 0.0;
+
+        // cos(m phi) picks even powers of y, sin(m phi) picks odd ones
+        const int comp = (m >= 0) ? 1 : -1;
+        const int i = abs_m - lx;
+        if (comp != parity(std::abs(i)))
+            return 0.0;
+
+        double pfac = std::sqrt(factorial(2 * lx) * factorial(2 * ly) * factorial(2 * lz) * factorial(L) * factorial(L - abs_m) /
+                                (factorial(2 * L) * factorial(lx) * factorial(ly) * factorial(lz) * factorial(L + abs_m)));
+        pfac /= static_cast<double>(1 << L) * factorial(L);
+        pfac *= (m < 0) ? parity((i - 1) / 2) : parity(i / 2);
+
+        double sum = 0.0;
+        for (int k = j; k <= (L - abs_m) / 2; ++k)
+        {
+            const double pfac1 = binomial(L, k) * binomial(k, j) * parity(k) * factorial(2 * (L - k)) / factorial(L - abs_m - 2 * k);
+
+            double sum1 = 0.0;
+            for (int t = std::max((lx - abs_m) / 2, 0); t <= std::min(j, lx / 2); ++t)
+            {
+                if (lx - 2 * t <= abs_m)
+                    sum1 += binomial(j, t) * binomial(abs_m, lx - 2 * t) * parity(t);
+            }
+
+            sum += pfac1 * sum1;
+        }
+
+        // Convert from unit-normalized Cartesian components to the common x^L normalization
+        sum *= std::sqrt(double_factorial(2 * L - 1) / (double_factorial(2 * lx - 1) * double_factorial(2 * ly - 1) * double_factorial(2 * lz - 1)));
+
+        return (m == 0) ? pfac * sum : std::sqrt(2.0) * pfac * sum;
+    }
+
+    std::vector<double> build_cartesian_to_spherical(int L)
+    {
+        const auto cart = cartesian_shell_order(L);
+        const auto pure = spherical_shell_order(L);
+
+        std::vector<double> T(pure.size() * cart.size(), 0.0);
+        for (std::size_t p = 0; p < pure.size(); ++p)
+            for (std::size_t c = 0; c < cart.size(); ++c)
+                T[p * cart.size() + c] = solid_harmonic_coefficient(L, pure[p], cart[c][0], cart[c][1], cart[c][2]);
+
+        return T;
+    }
+}
+
+const std::vector<double> &cartesian_to_spherical(int L)
+{
+    // Built once on first use; function-local statics are thread-safe
+    static const std::array<std::vector<double>, MAX_SHELL_L + 1> table = []
+    {
+        std::array<std::vector<double>, MAX_SHELL_L + 1> t;
+        for (int l = 0; l <= MAX_SHELL_L; ++l)
+            t[l] = build_cartesian_to_spherical(l);
+        return t;
+    }();
+
+    if (L < 0 || L > MAX_SHELL_L)
+        throw std::runtime_error("cartesian_to_spherical: unsupported angular momentum " + std::to_string(L));
+
+    return table[L];
+}
+
 std::vector<double> primitive_normalization(int L, const std::vector<double> &exponents)
 {
     constexpr double pi = 3.1415926535897932384626433832795;
 
-    const double prefactor = std::pow(2.0, 2.0 * L + 1.5) / std::pow(pi, 1.5);
+    // Normalizes the x^L component; the other Cartesian components of the
+    // shell share this constant (e.g. d_xy carries a norm of 1/3)
+    const double prefactor = std::pow(2.0, 2.0 * L + 1.5) / (std::pow(pi, 1.5) * double_factorial(2 * L - 1));
 
     std::vector<double> norms;
     norms.reserve(exponents.size());
@@ -95,9 +209,10 @@ double contraction_normalization(int L, const std::vector<double> &exponents, co
 
             const double aij = ai + aj;
 
+            // Overlap of the unnormalized x^L primitives: (2L-1)!! / (2 α_ij)^L * (π/α_ij)^(3/2)
             const double Sij =
                 std::pow(pi / aij, 1.5) *
-                std::pow(2.0 * std::sqrt(ai * aj) / aij, L);
+                double_factorial(2 * L - 1) / std::pow(2.0 * aij, L);
 
             sum += ci * cj * Ni * Nj * Sij;
         }
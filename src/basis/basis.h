@@ -1,9 +1,12 @@
 #pragma once
 
 #include <array>
+#include <bitset>
+#include <functional>
 #include <cstdint>
 #include <string>
 #include <cmath>
+#include <unordered_map>
 #include <vector>
 #include <stdexcept>
 #include <string>
@@ -28,6 +31,8 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  ----------------------------------------------------------------------------*/
 
+constexpr double ANGSTROM_TO_BOHR = 1.889726124565062;
+
 enum class ShellType
 {
     Cartesian,
@@ -41,8 +46,16 @@ int shell_label_to_L(const std::string &label);
 // Example: L = 1 → { {1,0,0}, {0,1,0}, {0,0,1} }
 std::vector<std::array<int, 3>> cartesian_shell_order(int L);
 
-// (Optional, later)
-// std::vector<std::array<int,3>> spherical_shell_order(int L);
+// Highest angular momentum supported by shell_label_to_L (H shells)
+constexpr int MAX_SHELL_L = 5;
+
+// Real solid-harmonic components m for given L, ordered -L ... +L
+std::vector<int> spherical_shell_order(int L);
+
+// Cartesian → real solid-harmonic transformation for one shell
+// Row-major (2L+1) × (L+1)(L+2)/2 matrix; rows follow spherical_shell_order,
+// columns follow cartesian_shell_order
+const std::vector<double> &cartesian_to_spherical(int L);
 
 // Primitive normalization constants for a shell of angular momentum L
 // Returns vector N_i for each exponent α_i
@@ -53,5 +66,44 @@ double contraction_normalization(int L, const std::vector<double> &exponents, co
 // (mostly useful for testing / validation)
 std::vector<double> cartesian_normalization(const std::array<int, 3> &am, const std::vector<double> &coefficients, const std::vector<double> &exponents);
 
+struct GbsPrimitive
+{
+    double exponent;
+    double coefficient;
+};
+
+struct GbsShell
+{
+    std::string label; // "S", "P", "D", ...
+    std::vector<GbsPrimitive> primitives;
+};
+
+// Parsed contents of a .gbs file: element symbol → contracted shells
+using BasisSet = std::unordered_map<std::string, std::vector<GbsShell>>;
+
+// Set of atomic numbers, indexed by Z
+using ElementMask = std::bitset<119>;
+
+// Elements present in a molecule
+ElementMask element_mask(const Molecule &molecule);
+
+// Parse a Basis Set Exchange .gbs file, either completely or only the blocks
+// of the given elements (the others are skipped without being parsed)
+BasisSet read_gbs(const std::string &filename);
+BasisSet read_gbs(const std::string &filename, const ElementMask &elements);
+
+// Normalize one contracted shell of element Z and append it to the primitive
+// arena and basis.templates
+void add_shell_template(Basis &basis, std::uint64_t Z, int L, std::span<const double> exponents, std::span<const double> coefficients);
+
+// Place shells on every atom of a molecule. add_templates(Z, basis) is called
+// once per element and must add that element's templates (or throw if the
+// basis set lacks it); atoms of the same element then share them.
+Basis place_shells(const Molecule &molecule, ShellType shell_type, const std::function<void(std::uint64_t, Basis &)> &add_templates);
+
+// Place the shells of a parsed basis set on the atoms of a molecule
+Basis build_basis(const BasisSet &gbs, const Molecule &molecule, ShellType shell_type);
+
 // Read a Basis Set Exchange .gbs file and build a Basis
 Basis read_gbs_basis(const std::string &filename, const Molecule &molecule, ShellType shell_type);
+
@@ -0,0 +1,310 @@
+#include "compiled.h"
+#include "lookup/elements.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+namespace
+{
+    constexpr char compiled_magic[8] = {'P', 'L', 'A', 'N', 'C', 'K', 'B', 'S'};
+
+    std::expected<std::vector<std::byte>, std::string> read_bytes(const std::string &filename)
+    {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file)
+            return std::unexpected("Cannot open " + filename);
+
+        std::vector<std::byte> bytes(static_cast<std::size_t>(file.tellg()));
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size())))
+            return std::unexpected("Cannot read " + filename);
+
+        return bytes;
+    }
+
+    std::int64_t mtime_ns(const struct stat &info) noexcept
+    {
+        return static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    }
+
+    template <typename T>
+    void write_array(std::ofstream &out, const T *data, std::size_t count)
+    {
+        out.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(count * sizeof(T)));
+    }
+}
+
+std::uint64_t fnv1a_checksum(std::span<const std::byte> bytes) noexcept
+{
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::byte b : bytes)
+    {
+        hash ^= static_cast<std::uint64_t>(b);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::expected<void, std::string> compile_basis_set(const std::string &source, const std::string &target)
+{
+    auto bytes = read_bytes(source);
+    if (!bytes)
+        return std::unexpected(bytes.error());
+
+    BasisSet gbs;
+    try
+    {
+        gbs = read_gbs(source);
+    }
+    catch (const std::exception &e)
+    {
+        return std::unexpected(source + " : " + e.what());
+    }
+
+    std::vector<CompiledElement> elements(MAX_COMPILED_Z + 1, CompiledElement{0, 0});
+    std::vector<CompiledShell> shells;
+    std::vector<double> exponents, coefficients;
+
+    // Elements in order of Z, shells in file order
+    for (std::size_t Z = 1; Z <= MAX_COMPILED_Z; ++Z)
+    {
+        const ElementData *element = nullptr;
+        try
+        {
+            element = &element_from_z(Z);
+        }
+        catch (const std::exception &)
+        {
+            break;
+        }
+
+        auto it = gbs.find(std::string(element->symbol));
+        if (it == gbs.end() || it->second.empty())
+            continue;
+
+        elements[Z] = {static_cast<std::uint32_t>(shells.size()), static_cast<std::uint32_t>(it->second.size())};
+
+        for (const GbsShell &gbs_shell : it->second)
+        {
+            shells.push_back({shell_label_to_L(gbs_shell.label), static_cast<std::uint32_t>(gbs_shell.primitives.size()), exponents.size()});
+
+            for (const auto &p : gbs_shell.primitives)
+            {
+                exponents.push_back(p.exponent);
+                coefficients.push_back(p.coefficient);
+            }
+        }
+    }
+
+    CompiledHeader header{};
+    std::memcpy(header.magic, compiled_magic, sizeof(compiled_magic));
+    header.version = COMPILED_BASIS_VERSION;
+    header.nelements = static_cast<std::uint32_t>(std::count_if(elements.begin(), elements.end(), [](const CompiledElement &e)
+                                                                { return e.nshells > 0; }));
+
+    struct stat info{};
+    if (stat(source.c_str(), &info) != 0)
+        return std::unexpected("Cannot stat " + source);
+
+    header.source_size = bytes->size();
+    header.source_mtime_ns = mtime_ns(info);
+    header.source_checksum = fnv1a_checksum(*bytes);
+    header.nshells = shells.size();
+    header.nprimitives = exponents.size();
+
+    // Write to a temporary name and rename, so readers never see a partial file
+    const std::string partial = target + ".tmp";
+    {
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return std::unexpected("Cannot write " + partial);
+
+        write_array(out, &header, 1);
+        write_array(out, elements.data(), elements.size());
+        write_array(out, shells.data(), shells.size());
+        write_array(out, exponents.data(), exponents.size());
+        write_array(out, coefficients.data(), coefficients.size());
+
+        if (!out)
+            return std::unexpected("Failed writing " + partial);
+    }
+
+    if (std::rename(partial.c_str(), target.c_str()) != 0)
+        return std::unexpected("Cannot rename " + partial + " to " + target);
+
+    return {};
+}
+
+std::expected<CompiledBasisSet, std::string> CompiledBasisSet::open(const std::string &filename, const std::string &source)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return std::unexpected("Cannot open " + filename);
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(CompiledHeader))
+    {
+        ::close(fd);
+        return std::unexpected(filename + " is not a compiled basis set");
+    }
+
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (map == MAP_FAILED)
+        return std::unexpected("Cannot map " + filename);
+
+    CompiledBasisSet compiled;
+    compiled.map_ = map;
+    compiled.map_size_ = size;
+
+    const auto *base = static_cast<const std::byte *>(map);
+    const auto *header = reinterpret_cast<const CompiledHeader *>(base);
+
+    if (std::memcmp(header->magic, compiled_magic, sizeof(compiled_magic)) != 0 || header->version != COMPILED_BASIS_VERSION)
+        return std::unexpected(filename + " is not a compiled basis set of version " + std::to_string(COMPILED_BASIS_VERSION));
+
+    const std::size_t elements_offset = sizeof(CompiledHeader);
+    const std::size_t shells_offset = elements_offset + (MAX_COMPILED_Z + 1) * sizeof(CompiledElement);
+
+    // The counts come from the file; bounding them by the file size first
+    // keeps the offsets below from wrapping around
+    if (size < shells_offset || header->nshells > size / sizeof(CompiledShell) || header->nprimitives > size / (2 * sizeof(double)))
+        return std::unexpected(filename + " is truncated");
+
+    const std::size_t exponents_offset = shells_offset + header->nshells * sizeof(CompiledShell);
+    const std::size_t coefficients_offset = exponents_offset + header->nprimitives * sizeof(double);
+
+    if (coefficients_offset + header->nprimitives * sizeof(double) != size)
+        return std::unexpected(filename + " is truncated");
+
+    compiled.header_ = header;
+    compiled.elements_ = reinterpret_cast<const CompiledElement *>(base + elements_offset);
+    compiled.shells_ = reinterpret_cast<const CompiledShell *>(base + shells_offset);
+    compiled.exponents_ = reinterpret_cast<const double *>(base + exponents_offset);
+    compiled.coefficients_ = reinterpret_cast<const double *>(base + coefficients_offset);
+
+    // Bounds of every record, so lookups need no checks later
+    for (std::size_t Z = 0; Z <= MAX_COMPILED_Z; ++Z)
+    {
+        const CompiledElement &element = compiled.elements_[Z];
+        if (std::uint64_t{element.first_shell} + element.nshells > header->nshells)
+            return std::unexpected(filename + " has a corrupt element index");
+    }
+
+    for (std::size_t s = 0; s < header->nshells; ++s)
+    {
+        const CompiledShell &shell = compiled.shells_[s];
+        if (shell.first_primitive > header->nprimitives || shell.nprimitives > header->nprimitives - shell.first_primitive ||
+            shell.L < 0 || shell.L > MAX_SHELL_L)
+            return std::unexpected(filename + " has a corrupt shell record");
+    }
+
+    // Stale if the text file changed after compilation (a missing text file
+    // leaves the image as the only copy, which is then trusted)
+    struct stat source_info{};
+    if (!source.empty() && stat(source.c_str(), &source_info) == 0)
+    {
+        if (static_cast<std::uint64_t>(source_info.st_size) != header->source_size)
+            return std::unexpected(filename + " is out of date with " + source);
+
+        if (mtime_ns(source_info) != header->source_mtime_ns)
+        {
+            auto bytes = read_bytes(source);
+            if (!bytes || fnv1a_checksum(*bytes) != header->source_checksum)
+                return std::unexpected(filename + " is out of date with " + source);
+        }
+    }
+
+    return compiled;
+}
+
+CompiledBasisSet::CompiledBasisSet(CompiledBasisSet &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+CompiledBasisSet &CompiledBasisSet::operator=(CompiledBasisSet &&other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        map_ = std::exchange(other.map_, nullptr);
+        map_size_ = std::exchange(other.map_size_, 0);
+        header_ = std::exchange(other.header_, nullptr);
+        elements_ = std::exchange(other.elements_, nullptr);
+        shells_ = std::exchange(other.shells_, nullptr);
+        exponents_ = std::exchange(other.exponents_, nullptr);
+        coefficients_ = std::exchange(other.coefficients_, nullptr);
+    }
+    return *this;
+}
+
+CompiledBasisSet::~CompiledBasisSet()
+{
+    unmap();
+}
+
+void CompiledBasisSet::unmap() noexcept
+{
+    if (map_)
+        munmap(map_, map_size_);
+    map_ = nullptr;
+}
+
+std::span<const CompiledShell> CompiledBasisSet::shells(std::uint64_t Z) const noexcept
+{
+    if (Z > MAX_COMPILED_Z)
+        return {};
+
+    const CompiledElement &element = elements_[Z];
+    return {shells_ + element.first_shell, element.nshells};
+}
+
+std::span<const double> CompiledBasisSet::exponents(const CompiledShell &shell) const noexcept
+{
+    return {exponents_ + shell.first_primitive, shell.nprimitives};
+}
+
+std::span<const double> CompiledBasisSet::coefficients(const CompiledShell &shell) const noexcept
+{
+    return {coefficients_ + shell.first_primitive, shell.nprimitives};
+}
+
+Basis build_basis(const CompiledBasisSet &compiled, const Molecule &molecule, ShellType shell_type)
+{
+    return place_shells(molecule, shell_type, [&](std::uint64_t Z, Basis &basis)
+                        {
+        const auto shells = compiled.shells(Z);
+        if (shells.empty())
+            throw std::runtime_error("No basis for element " + std::string(element_from_z(Z).symbol));
+
+        for (const CompiledShell &shell : shells)
+            add_shell_template(basis, Z, shell.L, compiled.exponents(shell), compiled.coefficients(shell)); });
+}
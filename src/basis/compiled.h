@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <string>
+
+#include "base/base.h"
+#include "basis/basis.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Compiled basis set files (<name>.pbin next to <name>)
+//
+// A .gbs file compiled once, at install time, into a flat binary image that
+// is mapped read-only and used in place:
+//
+//     CompiledHeader
+//     CompiledElement[MAX_COMPILED_Z + 1]   indexed by atomic number
+//     CompiledShell[nshells]                SP shells already split
+//     double exponents[nprimitives]
+//     double coefficients[nprimitives]      as in the file, unnormalized
+//
+// The header records the size, modification time and checksum of the source
+// .gbs, so an edited text file invalidates its compiled image. The checksum
+// is only recomputed when the size matches but the time does not (a copied
+// or touched file), which keeps the common path free of reading the text.
+// Files are written in host byte order and are not meant to be moved between
+// architectures.
+
+constexpr std::uint32_t COMPILED_BASIS_VERSION = 1;
+constexpr std::size_t MAX_COMPILED_Z = 118;
+constexpr const char *COMPILED_BASIS_EXTENSION = ".pbin";
+
+struct CompiledHeader
+{
+    char magic[8]; // "PLANCKBS"
+    std::uint32_t version;
+    std::uint32_t nelements; // elements with at least one shell
+    std::uint64_t source_size;
+    std::int64_t source_mtime_ns;
+    std::uint64_t source_checksum;
+    std::uint64_t nshells;
+    std::uint64_t nprimitives;
+};
+
+struct CompiledElement
+{
+    std::uint32_t first_shell;
+    std::uint32_t nshells; // 0 if the element is not in the basis set
+};
+
+struct CompiledShell
+{
+    std::int32_t L;
+    std::uint32_t nprimitives;
+    std::uint64_t first_primitive;
+};
+
+// 64-bit FNV-1a checksum of a byte range
+std::uint64_t fnv1a_checksum(std::span<const std::byte> bytes) noexcept;
+
+// Compile the .gbs file `source` into `target`
+std::expected<void, std::string> compile_basis_set(const std::string &source, const std::string &target);
+
+// Read-only mapping of a compiled basis set
+class CompiledBasisSet
+{
+public:
+    // Map `filename`; fails if it is missing, malformed, or does not match
+    // `source` (skip the check by passing an empty source)
+    static std::expected<CompiledBasisSet, std::string> open(const std::string &filename, const std::string &source);
+
+    CompiledBasisSet(CompiledBasisSet &&other) noexcept;
+    CompiledBasisSet &operator=(CompiledBasisSet &&other) noexcept;
+    ~CompiledBasisSet();
+
+    CompiledBasisSet(const CompiledBasisSet &) = delete;
+    CompiledBasisSet &operator=(const CompiledBasisSet &) = delete;
+
+    const CompiledHeader &header() const noexcept { return *header_; }
+
+    // Shells of element Z (empty if the basis set does not cover it)
+    std::span<const CompiledShell> shells(std::uint64_t Z) const noexcept;
+
+    std::span<const double> exponents(const CompiledShell &shell) const noexcept;
+    std::span<const double> coefficients(const CompiledShell &shell) const noexcept;
+
+private:
+    CompiledBasisSet() = default;
+    void unmap() noexcept;
+
+    void *map_ = nullptr;
+    std::size_t map_size_ = 0;
+
+    const CompiledHeader *header_ = nullptr;
+    const CompiledElement *elements_ = nullptr;
+    const CompiledShell *shells_ = nullptr;
+    const double *exponents_ = nullptr;
+    const double *coefficients_ = nullptr;
+};
+
+// Place the shells of a compiled basis set on the atoms of a molecule
+Basis build_basis(const CompiledBasisSet &compiled, const Molecule &molecule, ShellType shell_type);
@@ -1,6 +1,9 @@
+#include <algorithm>
+#include <charconv>
 #include <fstream>
-#include <sstream>
+#include <functional>
 #include <stdexcept>
+#include <string_view>
 #include <unordered_map>
 #include <array>
 #include <vector>
@@ -9,6 +12,7 @@
 
 #include "base/base.h"
 #include "basis.h"
+#include "io/text.h"
 #include "lookup/elements.h"
 
 /*-----------------------------------------------------------------------------
@@ -28,195 +32,305 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  ----------------------------------------------------------------------------*/
 
-constexpr double ANGSTROM_TO_BOHR = 1.889726124565062;
-
-struct GbsPrimitive
+namespace
 {
-    double exponent;
-    double coefficient;
-};
+    using Text::count_tokens;
+    using Text::LineCursor;
+    using Text::next_token;
+    using Text::parse_number;
+    using Text::trim;
+
+    // Real number that may use a Fortran 'D' exponent (0.18D+02)
+    double parse_real(std::string_view token, std::string_view line)
+    {
+        double value = 0.0;
 
-struct GbsShell
-{
-    std::string label; // "S", "P", "D", ...
-    std::vector<GbsPrimitive> primitives;
-};
+        const auto exponent = token.find_first_of("Dd");
+        if (exponent == std::string_view::npos)
+        {
+            if (parse_number(token, value))
+                return value;
+        }
+        else
+        {
+            // from_chars only knows 'E'; patch a short copy of the token
+            char buffer[64];
+            if (token.size() < sizeof(buffer))
+            {
+                std::copy(token.begin(), token.end(), buffer);
+                buffer[exponent] = 'E';
+                if (parse_number(std::string_view(buffer, token.size()), value))
+                    return value;
+            }
+        }
 
-static inline void normalize_fortran_exponents(std::string &line)
-{
-    for (char &c : line)
-        if (c == 'D' || c == 'd')
-            c = 'E';
-}
+        throw std::runtime_error("Malformed number in basis file: " + std::string(line));
+    }
 
-static bool starts_with_alpha(const std::string &line)
-{
-    for (char c : line)
+    bool is_shell_label(std::string_view s) noexcept
     {
-        if (!std::isspace(static_cast<unsigned char>(c)))
-            return std::isalpha(static_cast<unsigned char>(c));
+        return s == "S" || s == "P" || s == "D" ||
+               s == "F" || s == "G" || s == "H" ||
+               s == "SP";
     }
-    return false;
-}
 
-static bool is_shell_label(const std::string &s)
-{
-    return s == "S" || s == "P" || s == "D" ||
-           s == "F" || s == "G" || s == "H" ||
-           s == "SP";
-}
-
-using BasisSet = std::unordered_map<std::string, std::vector<GbsShell>>;
-
-static BasisSet read_gbs(std::istream &in)
-{
-    BasisSet basis;
-    std::string line;
-    std::string current_element;
-
-    while (std::getline(in, line))
+    // Parse the element blocks selected by `wanted` (all blocks if null)
+    BasisSet parse_gbs(std::string_view text, const ElementMask *wanted)
     {
-        if (line.empty())
-            continue;
+        BasisSet basis;
+        LineCursor cursor(text);
+        std::string_view line;
+        std::vector<GbsShell> *current = nullptr;
 
-        if (line == "****")
+        auto next_line = [&]() -> std::string_view
         {
-            current_element.clear();
-            continue;
-        }
+            if (!cursor.next(line))
+                throw std::runtime_error("Unexpected end of basis file");
+            return line;
+        };
 
-        if (line.starts_with("!"))
+        while (cursor.next(line))
         {
-            continue;
-        }
-        
-        /* Element header */
-        {
-            std::istringstream header(line);
-            std::string symbol;
-            int charge;
+            line = trim(line);
+
+            if (line.empty() || line.front() == '!')
+                continue;
 
-            if ((header >> symbol >> charge) && header.eof())
+            if (line == "****")
             {
-                element_from_symbol(symbol); // validate
-                current_element = symbol;
-                basis.try_emplace(symbol);
+                current = nullptr;
                 continue;
             }
-        }
 
-        if (!starts_with_alpha(line))
-            throw std::runtime_error("Expected shell header, got: " + line);
+            /* Element header: "<symbol> <charge>" */
+            if (count_tokens(line) == 2)
+            {
+                std::string_view rest = line;
+                const std::string_view symbol = next_token(rest);
+                int charge = 0;
+
+                if (parse_number(next_token(rest), charge))
+                {
+                    const ElementData &element = element_from_symbol(symbol); // validate
+
+                    // Unwanted block: skip to its terminator without looking at it
+                    if (wanted && !wanted->test(element.Z))
+                    {
+                        while (cursor.next(line) && trim(line) != "****")
+                        {
+                        }
+                        current = nullptr;
+                        continue;
+                    }
+
+                    current = &basis[std::string(symbol)];
+                    continue;
+                }
+            }
 
-        if (current_element.empty())
-            throw std::runtime_error("Shell before element header");
+            if (!std::isalpha(static_cast<unsigned char>(line.front())))
+                throw std::runtime_error("Expected shell header, got: " + std::string(line));
 
-        std::istringstream iss(line);
-        std::string label;
-        std::size_t nprim;
-        double scale = 1.0;
+            if (!current)
+                throw std::runtime_error("Shell before element header");
 
-        iss >> label >> nprim >> scale;
+            std::string_view rest = line;
+            const std::string_view label = next_token(rest);
+            std::size_t nprim = 0;
+            double scale = 1.0;
 
-        if (!iss || !is_shell_label(label))
-            throw std::runtime_error("Malformed shell line: " + line);
+            if (!is_shell_label(label) || !parse_number(next_token(rest), nprim))
+                throw std::runtime_error("Malformed shell line: " + std::string(line));
 
-        if (label == "SP")
-        {
-            GbsShell s{"S"}, p{"P"};
+            if (const std::string_view token = next_token(rest); !token.empty())
+                scale = parse_real(token, line);
 
-            for (std::size_t i = 0; i < nprim; ++i)
+            if (label == "SP")
             {
-                std::getline(in, line);
-                normalize_fortran_exponents(line);
+                GbsShell s{"S", {}}, p{"P", {}};
+                s.primitives.reserve(nprim);
+                p.primitives.reserve(nprim);
+
+                for (std::size_t i = 0; i < nprim; ++i)
+                {
+                    std::string_view prim = next_line();
+                    const double expn = parse_real(next_token(prim), line);
+                    const double cs = parse_real(next_token(prim), line);
+                    const double cp = parse_real(next_token(prim), line);
+
+                    s.primitives.push_back({expn, cs * scale});
+                    p.primitives.push_back({expn, cp * scale});
+                }
+
+                current->push_back(std::move(s));
+                current->push_back(std::move(p));
+            }
+            else
+            {
+                GbsShell shell{std::string(label), {}};
+                shell.primitives.reserve(nprim);
 
-                std::istringstream prim(line);
-                double expn, cs, cp;
-                prim >> expn >> cs >> cp;
+                for (std::size_t i = 0; i < nprim; ++i)
+                {
+                    std::string_view prim = next_line();
+                    const double expn = parse_real(next_token(prim), line);
+                    const double coeff = parse_real(next_token(prim), line);
 
-                s.primitives.push_back({expn, cs * scale});
-                p.primitives.push_back({expn, cp * scale});
-            }
+                    shell.primitives.push_back({expn, coeff * scale});
+                }
 
-            basis[current_element].push_back(std::move(s));
-            basis[current_element].push_back(std::move(p));
+                current->push_back(std::move(shell));
+            }
         }
-        else
-        {
-            GbsShell shell{label};
 
-            for (std::size_t i = 0; i < nprim; ++i)
-            {
-                std::getline(in, line);
-                normalize_fortran_exponents(line);
+        return basis;
+    }
 
-                std::istringstream prim(line);
-                double expn, coeff;
-                prim >> expn >> coeff;
+    std::string read_file(const std::string &filename)
+    {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file)
+            throw std::runtime_error("Cannot open basis file: " + filename);
 
-                shell.primitives.push_back({expn, coeff * scale});
-            }
+        std::string text(static_cast<std::size_t>(file.tellg()), '\0');
+        file.seekg(0);
+        if (!file.read(text.data(), static_cast<std::streamsize>(text.size())))
+            throw std::runtime_error("Cannot read basis file: " + filename);
 
-            basis[current_element].push_back(std::move(shell));
-        }
+        return text;
     }
+}
 
-    return basis;
+BasisSet read_gbs(const std::string &filename)
+{
+    return parse_gbs(read_file(filename), nullptr);
+}
+
+BasisSet read_gbs(const std::string &filename, const ElementMask &elements)
+{
+    return parse_gbs(read_file(filename), &elements);
+}
+
+ElementMask element_mask(const Molecule &molecule)
+{
+    ElementMask mask;
+    for (std::uint64_t Z : molecule.atomic_numbers)
+    {
+        if (Z < mask.size())
+            mask.set(Z);
+    }
+    return mask;
 }
 
 Basis read_gbs_basis(const std::string &filename, const Molecule &molecule, ShellType shell_type)
 {
-    std::ifstream file(filename);
-    if (!file)
-        throw std::runtime_error("Cannot open basis file: " + filename);
+    return build_basis(read_gbs(filename, element_mask(molecule)), molecule, shell_type);
+}
+
+void add_shell_template(Basis &basis, std::uint64_t Z, int L, std::span<const double> exponents, std::span<const double> coefficients)
+{
+    const std::vector<double> alpha(exponents.begin(), exponents.end());
+    std::vector<double> c(coefficients.begin(), coefficients.end());
+
+    // perform normalizations
+    const std::vector<double> norms = primitive_normalization(L, alpha);
+    const double Nc = contraction_normalization(L, alpha, c, norms);
+    for (double &ci : c)
+        ci *= Nc;
+
+    basis.templates.push_back({Z, L, basis.primitive_exponents.size(), alpha.size()});
+    basis.primitive_exponents.insert(basis.primitive_exponents.end(), alpha.begin(), alpha.end());
+    basis.primitive_coefficients.insert(basis.primitive_coefficients.end(), c.begin(), c.end());
+    basis.primitive_norms.insert(basis.primitive_norms.end(), norms.begin(), norms.end());
+}
 
-    BasisSet gbs = read_gbs(file);
+Basis place_shells(const Molecule &molecule, ShellType shell_type, const std::function<void(std::uint64_t, Basis &)> &add_templates)
+{
     Basis basis;
 
+    // Templates of each element seen so far, as a range of Basis::templates
+    std::unordered_map<std::uint64_t, std::pair<std::size_t, std::size_t>> element_templates;
+
     for (std::size_t a = 0; a < molecule.natoms; ++a)
     {
-        std::string element = std::string(element_from_z(molecule.atomic_numbers[a]).symbol);
+        const std::uint64_t Z = molecule.atomic_numbers[a];
 
-        auto it = gbs.find(element);
-        if (it == gbs.end())
-            throw std::runtime_error("No basis for element " + element);
+        auto it = element_templates.find(Z);
+        if (it == element_templates.end())
+        {
+            const std::size_t first = basis.templates.size();
+            add_templates(Z, basis);
+            it = element_templates.emplace(Z, std::make_pair(first, basis.templates.size())).first;
+        }
 
         std::array<double, 3> center = {
             molecule.coordinates[3 * a + 0] * ANGSTROM_TO_BOHR,
             molecule.coordinates[3 * a + 1] * ANGSTROM_TO_BOHR,
             molecule.coordinates[3 * a + 2] * ANGSTROM_TO_BOHR};
 
-        for (const GbsShell &gbs_shell : it->second)
+        for (std::size_t t = it->second.first; t < it->second.second; ++t)
         {
+            const ShellTemplate &shape = basis.templates[t];
+
             Shell shell;
             shell.center = center;
-            shell.L = shell_label_to_L(gbs_shell.label);
+            shell.atom = a;
+            shell.L = shape.L;
+            shell.template_index = t;
+            shell.first_primitive = shape.first_primitive;
+            shell.primitive_count = shape.primitive_count;
 
-            const std::size_t nprim = gbs_shell.primitives.size();
-            shell.exponents.reserve(nprim);
-            shell.coefficients.reserve(nprim);
+            // s and p solid harmonics span the same space as their Cartesian
+            // counterparts, so only d and higher shells are transformed
+            shell.pure = (shell_type == ShellType::Spherical) && (shell.L >= 2);
 
-            for (const auto &p : gbs_shell.primitives)
+            const std::size_t shell_index = basis.shells.size();
+            basis.shells.push_back(shell);
+            basis.shell_offsets.push_back(basis.functions.size());
+
+            if (shell.pure)
             {
-                shell.exponents.push_back(p.exponent);
-                shell.coefficients.push_back(p.coefficient);
+                for (int m : spherical_shell_order(shell.L))
+                {
+                    basis.functions.push_back({shell_index, {}, m});
+                }
             }
-
-            // perform normalizations
-            shell.prim_norms = primitive_normalization(shell.L, shell.exponents);
-            const double Nc = contraction_normalization(shell.L, shell.exponents, shell.coefficients, shell.prim_norms);
-            for (double &c : shell.coefficients)
-                c *= Nc;
-
-            basis.shells.push_back(std::move(shell));
-            const Shell *shell_ptr = &basis.shells.back();
-
-            for (auto am : cartesian_shell_order(shell_ptr->L))
+            else
             {
-                basis.functions.emplace_back(shell_ptr, am);
+                for (auto am : cartesian_shell_order(shell.L))
+                {
+                    basis.functions.push_back({shell_index, am, 0});
+                }
             }
         }
     }
 
     return basis;
 }
+
+Basis build_basis(const BasisSet &gbs, const Molecule &molecule, ShellType shell_type)
+{
+    std::vector<double> exponents, coefficients;
+
+    return place_shells(molecule, shell_type, [&](std::uint64_t Z, Basis &basis)
+                        {
+        const std::string element = std::string(element_from_z(Z).symbol);
+
+        auto it = gbs.find(element);
+        if (it == gbs.end())
+            throw std::runtime_error("No basis for element " + element);
+
+        for (const GbsShell &gbs_shell : it->second)
+        {
+            exponents.clear();
+            coefficients.clear();
+
+            for (const auto &p : gbs_shell.primitives)
+            {
+                exponents.push_back(p.exponent);
+                coefficients.push_back(p.coefficient);
+            }
+
+            add_shell_template(basis, Z, shell_label_to_L(gbs_shell.label), exponents, coefficients);
+        } });
+}
@@ -0,0 +1,67 @@
+#include "library.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+BasisLibrary::Entry BasisLibrary::load(const std::string &filename, const ElementMask &elements)
+{
+    // Loading under the lock keeps concurrent jobs from reading the same file
+    // twice; jobs almost always share one or two basis sets
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto it = entries_.find(filename);
+    if (it == entries_.end())
+    {
+        Entry entry;
+        if (auto compiled = CompiledBasisSet::open(filename + COMPILED_BASIS_EXTENSION, filename))
+            entry.compiled = std::make_shared<const CompiledBasisSet>(std::move(*compiled));
+        else
+            entry.text = std::make_shared<const BasisSet>();
+
+        it = entries_.emplace(filename, std::move(entry)).first;
+    }
+
+    Entry &entry = it->second;
+    const ElementMask missing = elements & ~entry.requested;
+
+    if (!entry.compiled && missing.any())
+    {
+        // Jobs may still hold the current set, so extend a copy
+        auto extended = std::make_shared<BasisSet>(*entry.text);
+        extended->merge(read_gbs(filename, missing));
+
+        entry.text = std::move(extended);
+        entry.requested |= missing;
+    }
+
+    return entry;
+}
+
+Basis BasisLibrary::build(const std::string &filename, const Molecule &molecule, ShellType shell_type)
+{
+    const Entry entry = load(filename, element_mask(molecule));
+
+    if (entry.compiled)
+        return build_basis(*entry.compiled, molecule, shell_type);
+
+    return build_basis(*entry.text, molecule, shell_type);
+}
+
+bool BasisLibrary::is_compiled(const std::string &filename)
+{
+    return load(filename, ElementMask{}).compiled != nullptr;
+}
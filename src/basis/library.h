@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "base/base.h"
+#include "basis/basis.h"
+#include "basis/compiled.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Basis set files shared by all jobs of one process
+//
+// The first request for a file maps its compiled image (<file>.pbin) if one
+// exists and matches the text file. Otherwise only the element blocks a job
+// needs are parsed from the .gbs text, and later jobs that bring new
+// elements parse those blocks on top. Everything loaded is kept for the
+// lifetime of the library. Safe to call from any thread.
+class BasisLibrary
+{
+public:
+    Basis build(const std::string &filename, const Molecule &molecule, ShellType shell_type);
+
+    // Whether `filename` is served from its compiled image
+    bool is_compiled(const std::string &filename);
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const CompiledBasisSet> compiled;
+        std::shared_ptr<const BasisSet> text;
+        ElementMask requested; // elements already looked up in the text
+    };
+
+    Entry load(const std::string &filename, const ElementMask &elements);
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+};
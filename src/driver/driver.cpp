@@ -0,0 +1,384 @@
+#include "driver.h"
+#include "io/io.h"
+#include "io/json.h"
+#include "io/logging.h"
+#include "symmetry/symmetry.h"
+#include "integrals/nuclear.h"
+#include "integrals/obara-saika/obara-saika.h"
+#include "integrals/shell_pair.h"
+#include "parallel/distributed.h"
+#include "parallel/numa.h"
+#include "parallel/task_pool.h"
+#include "profile/timers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    void log_coordinates(const std::string &label, const Molecule &molecule, const std::vector<double> &coordinates)
+    {
+        logging(LogLevel::Info, label, "");
+
+        for (std::size_t index = 0; index < molecule.natoms; ++index)
+        {
+            std::string cstr;
+            std::ostringstream astream;
+            astream << std::setw(5) << std::right << molecule.atomic_numbers[index];
+            cstr += astream.str();
+
+            for (std::size_t cindex = 0; cindex < 3; ++cindex)
+            {
+                std::ostringstream oss;
+                oss << std::setw(10) << std::setprecision(3) << std::fixed << coordinates[3 * index + cindex];
+                cstr += oss.str();
+            }
+            logging(LogLevel::Info, "", cstr);
+        }
+    }
+
+    // Fills the calculator and molecule from wherever the input comes from
+    using InputParser = std::function<std::expected<void, std::string>(Calculator &, Molecule &)>;
+}
+
+static JobResult run_parsed(const std::string &input_name, const InputParser &parse_input, SharedCaches &caches, JobMode mode, const Driver::PointCallback &on_point)
+{
+    const auto job_start = std::chrono::steady_clock::now();
+    const bool verbose = (mode == JobMode::Single);
+
+    JobResult result;
+    result.input = input_name;
+
+    auto info = [verbose](const std::string &label, const std::string &message)
+    {
+        if (verbose)
+            logging(LogLevel::Info, label, message);
+    };
+
+    auto fail = [&](const std::string &stage, const std::string &message)
+    {
+        if (verbose)
+            logging(LogLevel::Error, stage + " :", message);
+
+        result.success = false;
+        result.error = stage + " : " + message;
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - job_start;
+        result.wall_seconds = elapsed.count();
+        return result;
+    };
+
+    Profile::ScopedTimer job_timer("Job");
+
+    try
+    {
+        // Core objects
+        Calculator calculator{};
+        Molecule molecule{};
+
+        // Parse input
+        {
+            Profile::ScopedTimer timer("Input Parsing");
+            if (auto res = parse_input(calculator, molecule); !res)
+                return fail("Input Parsing Failed", res.error());
+        }
+
+        result.calc_type = calculator.calc_type;
+        result.method = calculator.method;
+        result.basis_name = calculator.basis_name;
+        result.natoms = molecule.natoms;
+
+        info("Input Parsing :", "Successful");
+
+        // Now log all input options
+        info("Calculation Type :", calculator.calc_type);
+        info("Theory :", calculator.method);
+        info("Basis :", calculator.basis_name);
+        info("Basis Type :", calculator.basis_type);
+
+        // Page placement is process-wide; a batch keeps the policy it started with
+        if (mode == JobMode::Single)
+        {
+            Numa::set_policy(calculator.numa_policy);
+            info("NUMA Policy :", std::format("{} ({} nodes)", Numa::policy_name(calculator.numa_policy), Numa::nodes()));
+        }
+
+        if (calculator.basis_name.empty())
+            return fail("Basis Error", "No basis set file specified");
+
+        // Parse basis sets (each file once per process)
+        const fs::path gbs_path = calculator.basis_path + "/" + calculator.basis_name;
+        info("Reading Basis Set :", gbs_path.string());
+
+        try
+        {
+            const bool compiled = caches.basis_library.is_compiled(gbs_path.string());
+            info("Basis Set Format :", compiled ? "Compiled (memory mapped)" : "Text");
+        }
+        catch (const std::exception &e)
+        {
+            return fail("Basis Parsing Failed", e.what());
+        }
+
+        const ShellType shell_type = calculator.basis_type.compare("cartesian") == 0 ? ShellType::Cartesian : ShellType::Spherical;
+
+        // A single point is a scan over one geometry
+        const bool is_scan = !molecule.scan_frames.empty();
+        const std::vector<std::vector<double>> frames = is_scan ? molecule.scan_frames : std::vector<std::vector<double>>{molecule.coordinates};
+
+        if (is_scan)
+        {
+            info("Scan Points :", std::format("{}", frames.size()));
+        }
+
+        // Batch jobs run on pool threads, where MPI collectives are not allowed
+        const BatchDistribution distribution = verbose ? calculator.batch_distribution : BatchDistribution::Local;
+
+        // State carried from one scan point to the next
+        ShellPairList previous_pairs;
+
+        for (std::size_t point = 0; point < frames.size(); ++point)
+        {
+            Profile::ScopedTimer point_timer("Geometry Point");
+
+            if (is_scan)
+            {
+                info("Scan Point :", std::format("{} of {}", point + 1, frames.size()));
+            }
+
+            molecule.coordinates = frames[point];
+
+            // Detect Symmetry
+            if (!calculator.use_pgsymmetry)
+            {
+                info("Symmetry Detection :", "Symmetry detection is turned off by request");
+            }
+
+            info("Symmetry Detection :", "We use libmsym library to detect point groups");
+
+            {
+                Profile::ScopedTimer timer("Symmetry Detection");
+                if (auto res = detectSymmetry(molecule); !res)
+                    return fail("Symmetry Detection Failed", res.error());
+            }
+
+            result.point_group = molecule.point_group;
+
+            info("Symmetry Detection :", "Successful");
+            info("Point Group :", molecule.point_group);
+
+            result.nuclear_repulsion = nuclear_repulsion_energy(molecule);
+            info("Nuclear Repulsion :", std::format("{:.10f} Eh", result.nuclear_repulsion));
+
+            if (verbose)
+            {
+                log_coordinates("Input Coordinates :", molecule, molecule.coordinates);
+
+                if (molecule.is_reoriented)
+                    log_coordinates("Standard Coordinates :", molecule, molecule.coordinates_standard);
+            }
+
+            Basis basis;
+
+            try
+            {
+                Profile::ScopedTimer timer("Basis Construction");
+                basis = caches.basis_library.build(gbs_path.string(), molecule, shell_type); // cartesian or pure
+            }
+            catch (const std::exception &e)
+            {
+                return fail("Basis Parsing Failed", e.what());
+            }
+
+            result.nshells = basis.nshells();
+            result.nbf = basis.nbf();
+
+            info("Basis Construction :", std::format("Generated {} Shells and {} contracted functions", basis.nshells(), basis.nbf()));
+
+            if (verbose && point == 0 && Distributed::size() > 1)
+            {
+                info("MPI Ranks :", std::format("{}", Distributed::size()));
+            }
+
+            // Pairs of atoms that kept their positions reuse the previous point's data
+            ShellPairList shell_pairs;
+            {
+                Profile::ScopedTimer timer("Shell Pairs");
+                shell_pairs = build_shell_pairs(basis, point > 0 ? &previous_pairs : nullptr);
+            }
+            if (point > 0)
+            {
+                info("Shell Pairs :", std::format("{} of {} reused from the previous point", shell_pairs.reused, shell_pairs.size()));
+            }
+
+            if (verbose)
+                PLANCK_LOG_DEBUG("Shell Pair Arena :", std::format("{} pairs, {:.3f} MB", shell_pairs.size(), static_cast<double>(shell_pairs.arena.size() * sizeof(double)) / 1048576.0));
+
+            // One-electron integrals
+            RankLoad overlap_load;
+            std::vector<double> overlap;
+            {
+                Profile::ScopedTimer timer("One-Electron Integrals");
+                overlap = ObaraSaika::Overlap::computeOverlap(basis, shell_pairs, distribution, &overlap_load);
+            }
+            info("Overlap Matrix :", std::format("Computed {} x {} elements", basis.nbf(), basis.nbf()));
+
+            if (verbose)
+                Distributed::report_load_balance("Overlap", overlap_load);
+
+            ++result.scan_points;
+
+            if (on_point)
+            {
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - job_start;
+                result.wall_seconds = elapsed.count();
+                on_point(result);
+            }
+
+            previous_pairs = std::move(shell_pairs);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        return fail("Job Failed", e.what());
+    }
+
+    result.success = true;
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - job_start;
+    result.wall_seconds = elapsed.count();
+    return result;
+}
+
+JobResult Driver::run_job(const std::string &input_file, SharedCaches &caches, JobMode mode, const PointCallback &on_point)
+{
+    return run_parsed(input_file, [&](Calculator &calculator, Molecule &molecule)
+                      { return read_input_file(input_file, calculator, molecule); }, caches, mode, on_point);
+}
+
+JobResult Driver::run_job_text(const std::string &name, std::string_view text, const std::string &directory, SharedCaches &caches, JobMode mode, const PointCallback &on_point)
+{
+    return run_parsed(name, [&](Calculator &calculator, Molecule &molecule)
+                      { return read_input(text, directory, calculator, molecule); }, caches, mode, on_point);
+}
+
+std::expected<std::vector<std::string>, std::string> Driver::collect_inputs(const std::string &source)
+{
+    std::vector<std::string> inputs;
+    std::error_code ec;
+
+    if (fs::is_directory(source, ec))
+    {
+        for (const auto &entry : fs::directory_iterator(source, ec))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".inp")
+                inputs.push_back(entry.path().string());
+        }
+
+        if (ec)
+            return std::unexpected("Unable to read directory " + source + " : " + ec.message());
+
+        std::sort(inputs.begin(), inputs.end());
+    }
+    else
+    {
+        std::ifstream list(source);
+        if (!list)
+            return std::unexpected("Unable to open " + source);
+
+        const fs::path base = fs::path(source).parent_path();
+        std::string line;
+
+        while (std::getline(list, line))
+        {
+            const auto first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#')
+                continue;
+
+            const auto last = line.find_last_not_of(" \t\r");
+            const fs::path path = line.substr(first, last - first + 1);
+            inputs.push_back(path.is_absolute() ? path.string() : (base / path).string());
+        }
+    }
+
+    if (inputs.empty())
+        return std::unexpected("No input files found in " + source);
+
+    return inputs;
+}
+
+std::string Driver::to_json(const JobResult &result)
+{
+    return std::format("{{\"input\":\"{}\",\"status\":\"{}\",\"error\":\"{}\",\"calc_type\":\"{}\",\"theory\":\"{}\",\"basis\":\"{}\","
+                       "\"point_group\":\"{}\",\"natoms\":{},\"nshells\":{},\"nbf\":{},\"scan_points\":{},\"nuclear_repulsion\":{:.10f},\"wall_seconds\":{:.6f}}}",
+                       json_escape(result.input), result.success ? "ok" : "failed", json_escape(result.error),
+                       json_escape(result.calc_type), json_escape(result.method), json_escape(result.basis_name),
+                       json_escape(result.point_group), result.natoms, result.nshells, result.nbf, result.scan_points, result.nuclear_repulsion, result.wall_seconds);
+}
+
+std::expected<std::size_t, std::string> Driver::run_batch(const std::vector<std::string> &inputs, const std::string &results_file, SharedCaches &caches)
+{
+    const int rank = Distributed::rank();
+    const int nranks = Distributed::size();
+
+    const std::string output = (rank == 0) ? results_file : std::format("{}.{}", results_file, rank);
+    std::ofstream records(output);
+    if (!records)
+        return std::unexpected("Unable to open " + output);
+
+    // Larger input files usually mean larger molecules; start those first
+    std::vector<Task> tasks;
+    for (std::size_t i = static_cast<std::size_t>(rank); i < inputs.size(); i += nranks)
+    {
+        std::error_code ec;
+        const auto bytes = fs::file_size(inputs[i], ec);
+        tasks.push_back({i, ec ? 0.0 : static_cast<double>(bytes)});
+    }
+
+    std::mutex records_mutex;
+    std::size_t failed = 0;
+
+    Profile::ScopedTimer timer("Batch");
+    TaskPool::run(std::move(tasks), [&](const Task &task, int)
+                  {
+        const JobResult result = run_job(inputs[task.index], caches, JobMode::Batch);
+
+        if (result.success)
+            logging(LogLevel::Info, "Job Finished :", std::format("{} ({} functions, {:.3f} s)", result.input, result.nbf, result.wall_seconds));
+        else
+            logging(LogLevel::Error, "Job Failed :", std::format("{} ({})", result.input, result.error));
+
+        std::lock_guard<std::mutex> lock(records_mutex);
+        records << to_json(result) << '\n';
+        records.flush();
+        if (!result.success)
+            ++failed; });
+
+    return failed;
+}
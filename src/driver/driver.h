@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "base/base.h"
+#include "basis/library.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+enum class JobMode
+{
+    Single, // one input per process: full log, MPI-distributed integrals
+    Batch   // one of many inputs: silent, runs on the calling rank only
+};
+
+// Outcome of one input file
+struct JobResult
+{
+    std::string input;
+    bool success = false;
+    std::string error; // "<stage> : <message>" when success is false
+
+    std::string calc_type;
+    std::string method;
+    std::string basis_name;
+    std::string point_group;
+
+    std::size_t natoms = 0;
+    std::size_t nshells = 0;
+    std::size_t nbf = 0;
+    std::size_t scan_points = 0; // geometries computed (1 for a single point)
+
+    double nuclear_repulsion = 0.0; // Hartree, of the last geometry
+
+    double wall_seconds = 0.0;
+};
+
+// State shared by all jobs of one process
+// The element tables are static and need no entry here.
+struct SharedCaches
+{
+    BasisLibrary basis_library;
+};
+
+namespace Driver
+{
+    // Called after every computed geometry with the result so far
+    using PointCallback = std::function<void(const JobResult &)>;
+
+    // Run one input file from parsing to the last computed quantity.
+    // Never throws; failures are reported through JobResult::error.
+    JobResult run_job(const std::string &input_file, SharedCaches &caches, JobMode mode, const PointCallback &on_point = {});
+
+    // As run_job, for input text held in memory. Relative file names in it are
+    // taken from `directory`; `name` labels the result.
+    JobResult run_job_text(const std::string &name, std::string_view text, const std::string &directory, SharedCaches &caches, JobMode mode, const PointCallback &on_point = {});
+
+    // Input files of a batch: the *.inp files of a directory (sorted by name),
+    // or the lines of a list file (blank lines and '#' comments are skipped,
+    // relative paths are resolved against the directory of the list)
+    std::expected<std::vector<std::string>, std::string> collect_inputs(const std::string &source);
+
+    // Single-line JSON record of a job
+    std::string to_json(const JobResult &result);
+
+    // Run all inputs on the task pool, one job per task, and append one JSON
+    // record per job to results_file as jobs finish. With several MPI ranks the
+    // jobs are dealt round-robin and rank r > 0 writes to "<results_file>.<r>".
+    // Returns the number of failed jobs on this rank.
+    std::expected<std::size_t, std::string> run_batch(const std::vector<std::string> &inputs, const std::string &results_file, SharedCaches &caches);
+};
@@ -0,0 +1,443 @@
+#include "server.h"
+#include "io/json.h"
+#include "io/logging.h"
+#include "parallel/task_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <sstream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr std::size_t max_request_bytes = std::size_t{64} << 20;
+    constexpr int receive_timeout_seconds = 30; // to send a whole request, or to take a reply line
+    constexpr int listen_backlog = 64;
+    constexpr std::size_t max_pending = 64; // requests being read at once; more wait in the backlog
+
+    std::atomic<bool> stop_requested{false};
+
+    void on_stop_signal(int)
+    {
+        stop_requested.store(true, std::memory_order_relaxed);
+    }
+
+    std::string errno_message(const std::string &what)
+    {
+        return what + " : " + std::strerror(errno);
+    }
+
+    // Closes the descriptor it owns
+    struct FileDescriptor
+    {
+        int fd = -1;
+
+        explicit FileDescriptor(int descriptor) noexcept : fd(descriptor) {}
+        FileDescriptor(FileDescriptor &&other) noexcept : fd(std::exchange(other.fd, -1)) {}
+        FileDescriptor(const FileDescriptor &) = delete;
+        FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+        ~FileDescriptor()
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    };
+
+    // Removes the socket file and restores the signal handlers on the way out
+    struct ServerGuard
+    {
+        std::string path;
+        struct sigaction previous_int{};
+        struct sigaction previous_term{};
+        bool bound = false;
+        bool handlers = false;
+
+        ~ServerGuard()
+        {
+            if (bound)
+                ::unlink(path.c_str());
+
+            if (handlers)
+            {
+                sigaction(SIGINT, &previous_int, nullptr);
+                sigaction(SIGTERM, &previous_term, nullptr);
+            }
+        }
+    };
+
+    std::expected<sockaddr_un, std::string> socket_address(const std::string &path)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+
+        if (path.empty() || path.size() >= sizeof(address.sun_path))
+            return std::unexpected(std::format("Socket path must have 1 to {} characters", sizeof(address.sun_path) - 1));
+
+        std::memcpy(address.sun_path, path.data(), path.size());
+        return address;
+    }
+
+    bool send_all(int fd, std::string_view data)
+    {
+        while (!data.empty())
+        {
+            // A client that hung up must not kill the server with SIGPIPE
+            const ssize_t sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (sent < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data.remove_prefix(static_cast<std::size_t>(sent));
+        }
+        return true;
+    }
+
+    // A connection whose request is still arriving
+    struct PendingRequest
+    {
+        FileDescriptor client;
+        std::string text;
+        Clock::time_point deadline;
+    };
+
+    // Read what the (non-blocking) client has sent so far. Returns true once
+    // the client has shut down its side, i.e. the request is complete.
+    std::expected<bool, std::string> read_available(PendingRequest &request)
+    {
+        char buffer[65536];
+
+        while (true)
+        {
+            const ssize_t received = ::recv(request.client.fd, buffer, sizeof(buffer), 0);
+            if (received == 0)
+                return true;
+
+            if (received < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return false;
+                return std::unexpected(errno_message("Cannot read request"));
+            }
+
+            if (request.text.size() + static_cast<std::size_t>(received) > max_request_bytes)
+                return std::unexpected(std::format("Request larger than {} MB", max_request_bytes >> 20));
+
+            request.text.append(buffer, static_cast<std::size_t>(received));
+        }
+    }
+
+    // Replies are written blocking, but a client that stops reading gives up
+    // its reply after the timeout rather than holding the server
+    void prepare_reply(int fd)
+    {
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+        const timeval timeout{receive_timeout_seconds, 0};
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+
+    std::string_view trimmed(std::string_view text)
+    {
+        const auto first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string_view::npos)
+            return {};
+
+        const auto last = text.find_last_not_of(" \t\r\n");
+        return text.substr(first, last - first + 1);
+    }
+
+    std::string point_json(const JobResult &result)
+    {
+        return std::format("{{\"point\":{},\"point_group\":\"{}\",\"nbf\":{},\"nuclear_repulsion\":{:.10f},\"wall_seconds\":{:.6f}}}\n",
+                           result.scan_points, json_escape(result.point_group), result.nbf, result.nuclear_repulsion, result.wall_seconds);
+    }
+
+    // Replace the file of a server that is gone, but never a live server's
+    std::expected<void, std::string> remove_stale_socket(const std::string &path, const sockaddr_un &address)
+    {
+        struct stat info{};
+        if (lstat(path.c_str(), &info) != 0)
+            return {};
+
+        if (!S_ISSOCK(info.st_mode))
+            return std::unexpected(path + " exists and is not a socket");
+
+        FileDescriptor probe(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+        if (probe.fd >= 0 && ::connect(probe.fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0)
+            return std::unexpected("Another server is listening on " + path);
+
+        if (::unlink(path.c_str()) != 0)
+            return std::unexpected(errno_message("Cannot remove stale socket " + path));
+
+        return {};
+    }
+}
+
+std::expected<std::size_t, std::string> Driver::serve(const std::string &socket_path, SharedCaches &caches)
+{
+    auto address = socket_address(socket_path);
+    if (!address)
+        return std::unexpected(address.error());
+
+    if (auto removed = remove_stale_socket(socket_path, *address); !removed)
+        return std::unexpected(removed.error());
+
+    FileDescriptor listener(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0));
+    if (listener.fd < 0)
+        return std::unexpected(errno_message("Cannot create socket"));
+
+    ServerGuard guard{socket_path};
+
+    // Only the owner may connect; jobs can read any file the server can
+    const mode_t previous_mask = ::umask(0077);
+    const int bound = ::bind(listener.fd, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address));
+    ::umask(previous_mask);
+
+    if (bound != 0)
+        return std::unexpected(errno_message("Cannot bind " + socket_path));
+    guard.bound = true;
+
+    if (::listen(listener.fd, listen_backlog) != 0)
+        return std::unexpected(errno_message("Cannot listen on " + socket_path));
+
+    // Without SA_RESTART a signal also wakes the poll below
+    struct sigaction action{};
+    action.sa_handler = on_stop_signal;
+    sigemptyset(&action.sa_mask);
+    stop_requested.store(false, std::memory_order_relaxed);
+    sigaction(SIGINT, &action, &guard.previous_int);
+    sigaction(SIGTERM, &action, &guard.previous_term);
+    guard.handlers = true;
+
+    // Start the pool threads now rather than inside the first request
+    {
+        std::vector<Task> warmup;
+        for (int t = 0; t < TaskPool::max_threads(); ++t)
+            warmup.push_back({static_cast<std::size_t>(t), 1.0});
+        TaskPool::run(std::move(warmup), [](const Task &, int) {});
+    }
+
+    const std::string directory = std::filesystem::current_path().string();
+    logging(LogLevel::Info, "Server :", std::format("Listening on {} with {} threads", socket_path, TaskPool::max_threads()));
+
+    // Requests are read from all connections at once, so a client that
+    // connects and then stalls only holds its own connection. Jobs run one
+    // at a time, in the order their requests complete.
+    std::list<PendingRequest> pending;
+    std::size_t served = 0;
+    bool shutdown = false;
+
+    // Run one complete request; false once it asked the server to stop
+    auto handle = [&](PendingRequest &request)
+    {
+        const std::string_view text = trimmed(request.text);
+
+        // A client that only checks whether the server is up sends nothing
+        if (text.empty())
+            return true;
+
+        prepare_reply(request.client.fd);
+
+        if (text == "SHUTDOWN")
+        {
+            send_all(request.client.fd, "{\"status\":\"stopping\"}\n");
+            logging(LogLevel::Info, "Server :", "Shutdown requested");
+            return false;
+        }
+
+        const std::string name = std::format("request-{}", ++served);
+
+        // Results go out as they are computed; a client that left does not stop the job
+        bool connected = true;
+        const JobResult result = run_job_text(name, request.text, directory, caches, JobMode::Batch, [&](const JobResult &partial)
+                                              { connected = connected && send_all(request.client.fd, point_json(partial)); });
+
+        if (connected)
+            send_all(request.client.fd, to_json(result) + "\n");
+
+        if (result.success)
+            logging(LogLevel::Info, "Job Finished :", std::format("{} ({} functions, {:.3f} s)", result.input, result.nbf, result.wall_seconds));
+        else
+            logging(LogLevel::Error, "Job Failed :", std::format("{} ({})", result.input, result.error));
+
+        return true;
+    };
+
+    while (!shutdown && !stop_requested.load(std::memory_order_relaxed))
+    {
+        // Wake for new connections and request data, at the latest at the next deadline
+        std::vector<pollfd> ready = {{listener.fd, static_cast<short>(pending.size() < max_pending ? POLLIN : 0), 0}};
+        auto wait = std::chrono::milliseconds(1000);
+        const auto now = Clock::now();
+
+        for (const PendingRequest &request : pending)
+        {
+            ready.push_back({request.client.fd, POLLIN, 0});
+            wait = std::min(wait, std::max(std::chrono::milliseconds(0), std::chrono::ceil<std::chrono::milliseconds>(request.deadline - now)));
+        }
+
+        const int n = ::poll(ready.data(), ready.size(), static_cast<int>(wait.count()));
+        if (n < 0 && errno != EINTR)
+            return std::unexpected(errno_message("Cannot wait for connections"));
+        if (n < 0)
+            continue;
+
+        // Take in what arrived; a finished request leaves the pending list.
+        // Data is read before deadlines are checked, so a client that sent
+        // its request while a long job ran is not mistaken for a stalled one.
+        std::list<PendingRequest> complete;
+        std::size_t index = 1;
+        for (auto it = pending.begin(); it != pending.end(); ++index)
+        {
+            const auto current = it++;
+            if (!(ready[index].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+
+            auto finished = read_available(*current);
+            if (!finished)
+            {
+                logging(LogLevel::Error, "Server :", finished.error());
+                pending.erase(current);
+            }
+            else if (*finished)
+            {
+                complete.splice(complete.end(), pending, current);
+            }
+        }
+
+        const auto checked = Clock::now();
+        pending.remove_if([&](const PendingRequest &request)
+                          {
+            if (request.deadline > checked)
+                return false;
+            logging(LogLevel::Error, "Server :", std::format("No end of request after {} s", receive_timeout_seconds));
+            return true; });
+
+        // New connections, until the backlog is empty or enough are pending
+        while (pending.size() < max_pending)
+        {
+            FileDescriptor client(::accept4(listener.fd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK));
+            if (client.fd < 0)
+                break; // nothing left, or the client gave up before it was accepted
+
+            pending.push_back({std::move(client), {}, Clock::now() + std::chrono::seconds(receive_timeout_seconds)});
+        }
+
+        for (PendingRequest &request : complete)
+        {
+            if (!handle(request))
+            {
+                shutdown = true;
+                break;
+            }
+        }
+    }
+
+    logging(LogLevel::Info, "Server :", std::format("Stopped after {} jobs", served));
+    return served;
+}
+
+std::expected<bool, std::string> Driver::submit(const std::string &socket_path, const std::string &input_file)
+{
+    auto address = socket_address(socket_path);
+    if (!address)
+        return std::unexpected(address.error());
+
+    std::string request;
+    if (input_file != "SHUTDOWN")
+    {
+        std::ifstream file(input_file, std::ios::binary);
+        if (!file)
+            return std::unexpected("Unable to open " + input_file);
+
+        std::ostringstream text;
+        text << file.rdbuf();
+        request = text.str();
+    }
+    else
+    {
+        request = input_file;
+    }
+
+    FileDescriptor connection(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (connection.fd < 0)
+        return std::unexpected(errno_message("Cannot create socket"));
+
+    if (::connect(connection.fd, reinterpret_cast<const sockaddr *>(&*address), sizeof(*address)) != 0)
+        return std::unexpected(errno_message("Cannot connect to " + socket_path));
+
+    if (!send_all(connection.fd, request) || ::shutdown(connection.fd, SHUT_WR) != 0)
+        return std::unexpected(errno_message("Cannot send request"));
+
+    // Copy complete lines as they arrive; the last one is the job record
+    std::string pending, last_line;
+    char buffer[4096];
+
+    while (true)
+    {
+        const ssize_t received = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received < 0)
+            return std::unexpected(errno_message("Cannot read reply"));
+        if (received == 0)
+            break;
+
+        pending.append(buffer, static_cast<std::size_t>(received));
+
+        std::size_t end;
+        while ((end = pending.find('\n')) != std::string::npos)
+        {
+            last_line = pending.substr(0, end);
+            std::cout << last_line << '\n' << std::flush;
+            pending.erase(0, end + 1);
+        }
+    }
+
+    if (last_line.empty())
+        return std::unexpected("Server closed the connection without a reply");
+
+    return last_line.find("\"status\":\"failed\"") == std::string::npos;
+}
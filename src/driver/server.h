@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <string>
+
+#include "driver.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Server mode: one long-lived process runs jobs sent over a Unix domain socket.
+//
+// A connection carries one request: the text of an input file, ended by the
+// client closing its side for writing. The reply is one JSON object per line:
+// a {"point":...} line as every geometry finishes, then the job record of
+// Driver::to_json, after which the server closes the connection. Relative
+// file names in the input are taken from the server's working directory.
+// A request consisting of the word SHUTDOWN stops the server.
+namespace Driver
+{
+    // Serve requests until SHUTDOWN, SIGINT or SIGTERM. Requests are read
+    // from all connections at once, and a connection that does not complete
+    // its request within 30 s is dropped without delaying the others. Jobs
+    // run one at a time on the calling thread, in the order their requests
+    // complete, with the whole task pool and the shared caches. The socket is
+    // created readable by the owner only and removed on return. Returns the
+    // number of jobs served.
+    std::expected<std::size_t, std::string> serve(const std::string &socket_path, SharedCaches &caches);
+
+    // Send one input file to a server and copy the reply lines to stdout.
+    // Returns whether the job succeeded.
+    std::expected<bool, std::string> submit(const std::string &socket_path, const std::string &input_file);
+};
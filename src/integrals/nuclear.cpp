@@ -0,0 +1,71 @@
+#include "nuclear.h"
+#include "basis/basis.h"
+
+#include <array>
+#include <cmath>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+double nuclear_repulsion_energy(const Molecule &molecule)
+{
+    const std::vector<double> &xyz = molecule.coordinates;
+
+    double energy = 0.0;
+    for (std::size_t a = 0; a < molecule.natoms; ++a)
+    {
+        for (std::size_t b = 0; b < a; ++b)
+        {
+            const double dx = xyz[3 * a + 0] - xyz[3 * b + 0];
+            const double dy = xyz[3 * a + 1] - xyz[3 * b + 1];
+            const double dz = xyz[3 * a + 2] - xyz[3 * b + 2];
+            const double r = std::sqrt(dx * dx + dy * dy + dz * dz) * ANGSTROM_TO_BOHR;
+
+            energy += static_cast<double>(molecule.atomic_numbers[a] * molecule.atomic_numbers[b]) / r;
+        }
+    }
+
+    return energy;
+}
+
+std::vector<double> nuclear_repulsion_gradient(const Molecule &molecule)
+{
+    const std::vector<double> &xyz = molecule.coordinates;
+    std::vector<double> gradient(3 * molecule.natoms, 0.0);
+
+    for (std::size_t a = 0; a < molecule.natoms; ++a)
+    {
+        for (std::size_t b = 0; b < a; ++b)
+        {
+            std::array<double, 3> d;
+            for (int k = 0; k < 3; ++k)
+                d[k] = (xyz[3 * a + k] - xyz[3 * b + k]) * ANGSTROM_TO_BOHR;
+
+            const double r = std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+            const double scale = static_cast<double>(molecule.atomic_numbers[a] * molecule.atomic_numbers[b]) / (r * r * r);
+
+            // ∂(Z_A Z_B / R)/∂R_A = -Z_A Z_B (R_A - R_B) / R³
+            for (int k = 0; k < 3; ++k)
+            {
+                gradient[3 * a + k] -= scale * d[k];
+                gradient[3 * b + k] += scale * d[k];
+            }
+        }
+    }
+
+    return gradient;
+}
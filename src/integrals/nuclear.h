@@ -0,0 +1,30 @@
+#pragma once
+
+#include "base/base.h"
+
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Nuclear repulsion energy Σ_{A<B} Z_A Z_B / R_AB in Hartree, for the
+// molecule's input coordinates (Å)
+double nuclear_repulsion_energy(const Molecule &molecule);
+
+// Its derivative with respect to every nuclear coordinate (3 × natoms,
+// Hartree/bohr, in the frame of the input coordinates)
+std::vector<double> nuclear_repulsion_gradient(const Molecule &molecule);
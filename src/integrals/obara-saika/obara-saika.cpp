@@ -1,5 +1,8 @@
 #include "obara-saika.h"
 #include "integrals/shell_pair.h"
+#include "integrals/transform.h"
+#include "basis/basis.h"
+#include "profile/counters.h"
 
 #include <cmath>
 #include <numbers>
@@ -21,7 +24,7 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  ----------------------------------------------------------------------------*/
 
-static double ObaraSaika::Overlap::computePrimitive1D(int lA, int lB, double PA, double PB, double gamma)
+double ObaraSaika::Overlap::computePrimitive1D(int lA, int lB, double PA, double PB, double gamma)
 {
     // Base case: S(0,0) = 1
     if (lA == 0 && lB == 0)
@@ -29,7 +32,7 @@ static double ObaraSaika::Overlap::computePrimitive1D(int lA, int lB, double PA,
         return 1.0;
     }
 
-    // Recursion relations from Obara-Saika scheme
+    // Recursion relations from Obara-Saika scheme, with gamma = 1/(2*α_ij)
     // S(a+1,b) = PA * S(a,b) + gamma * [a*S(a-1,b) + b*S(a,b-1)]
     // S(a,b+1) = PB * S(a,b) + gamma * [a*S(a-1,b) + b*S(a,b-1)]
 
@@ -49,19 +52,19 @@ static double ObaraSaika::Overlap::computePrimitive1D(int lA, int lB, double PA,
 
             if (a > 0)
             {
-                // Increment a
+                // Increment a: S(a,b) from S(a-1,b)
                 S[a][b] = PA * S[a - 1][b];
                 if (a > 1)
-                    S[a][b] += gamma * a * S[a - 2][b] * 0.5; // Note: factor of 0.5 in gamma definition
+                    S[a][b] += gamma * (a - 1) * S[a - 2][b];
                 if (b > 0)
-                    S[a][b] += gamma * b * S[a - 1][b - 1] * 0.5;
+                    S[a][b] += gamma * b * S[a - 1][b - 1];
             }
             else
             {
-                // Increment b
+                // Increment b: S(0,b) from S(0,b-1)
                 S[a][b] = PB * S[a][b - 1];
                 if (b > 1)
-                    S[a][b] += gamma * b * S[a][b - 2] * 0.5;
+                    S[a][b] += gamma * (b - 1) * S[a][b - 2];
             }
         }
     }
@@ -102,13 +105,13 @@ double ObaraSaika::Overlap::computePrimtive3D(const std::array<int, 3> &am_a, co
     return norm * Sx * Sy * Sz;
 }
 
-double ObaraSaika::Overlap::computeContracted(const ContractedView &bf_a, const ContractedView &bf_b, const ShellPair &pair)
+double ObaraSaika::Overlap::computeContracted(const std::array<int, 3> &am_a, const std::array<int, 3> &am_b, const ShellPair &pair)
 {
     // Accumulate contribution from all primitive pairs
     double overlap = 0.0;
 
-    std::size_t nprimA = bf_a.exponents().size();
-    std::size_t nprimB = bf_b.exponents().size();
+    const std::size_t nprimA = pair.nprimA;
+    const std::size_t nprimB = pair.nprimB;
 
     std::size_t prim_idx = 0;
     for (std::size_t i = 0; i < nprimA; ++i)
@@ -116,7 +119,7 @@ double ObaraSaika::Overlap::computeContracted(const ContractedView &bf_a, const
         for (std::size_t j = 0; j < nprimB; ++j)
         {
             // Compute primitive overlap
-            double S_ij = ObaraSaika::Overlap::computePrimtive3D(bf_a.am, bf_b.am, pair, prim_idx);
+            double S_ij = ObaraSaika::Overlap::computePrimtive3D(am_a, am_b, pair, prim_idx);
 
             // Multiply by contraction coefficients and normalizations (in prefac)
             overlap += pair.prefac[prim_idx] * S_ij;
@@ -128,79 +131,248 @@ double ObaraSaika::Overlap::computeContracted(const ContractedView &bf_a, const
     return overlap;
 }
 
-std::vector<double> ObaraSaika::Overlap::computeOverlap(const Basis &basis)
+std::array<double, 3> ObaraSaika::Overlap::computeContractedDerivative(const std::array<int, 3> &am_a, const std::array<int, 3> &am_b, const ShellPair &pair, std::span<const double> expA)
 {
-    std::size_t nbf = basis.nbf();
-    std::size_t nshells = basis.nshells();
+    using std::numbers::pi;
+    std::array<double, 3> derivative{};
+
+    std::size_t prim_idx = 0;
+    for (std::size_t i = 0; i < pair.nprimA; ++i)
+    {
+        const double a = expA[i];
+
+        for (std::size_t j = 0; j < pair.nprimB; ++j)
+        {
+            const double alpha_ij = pair.alpha[prim_idx];
+            const double gamma = 0.5 / alpha_ij;
+
+            const std::array<double, 3> P = {pair.Px[prim_idx], pair.Py[prim_idx], pair.Pz[prim_idx]};
+
+            // Differentiating the function on A:
+            // ∂/∂A_x [x_A^l exp(-a x_A²)] = 2a x_A^(l+1) exp(-a x_A²) - l x_A^(l-1) exp(-a x_A²)
+            std::array<double, 3> S{}, dS{};
+            for (int d = 0; d < 3; ++d)
+            {
+                const double PA = P[d] - pair.centerA[d];
+                const double PB = P[d] - pair.centerB[d];
+
+                S[d] = computePrimitive1D(am_a[d], am_b[d], PA, PB, gamma);
+                dS[d] = 2.0 * a * computePrimitive1D(am_a[d] + 1, am_b[d], PA, PB, gamma);
+                if (am_a[d] > 0)
+                    dS[d] -= am_a[d] * computePrimitive1D(am_a[d] - 1, am_b[d], PA, PB, gamma);
+            }
+
+            const double scale = pair.prefac[prim_idx] * std::pow(pi / alpha_ij, 1.5);
+            derivative[0] += scale * dS[0] * S[1] * S[2];
+            derivative[1] += scale * S[0] * dS[1] * S[2];
+            derivative[2] += scale * S[0] * S[1] * dS[2];
+
+            ++prim_idx;
+        }
+    }
+
+    return derivative;
+}
+
+double ObaraSaika::Overlap::estimateFlops(int La, int Lb, std::size_t nprim_pairs)
+{
+    // Per primitive pair and Cartesian component pair: the three 1D
+    // recursions (about five operations per table entry) and a dozen for the
+    // distances, the 3D product and the contraction
+    static const auto table = []
+    {
+        std::array<std::array<double, MAX_SHELL_L + 1>, MAX_SHELL_L + 1> t{};
+        for (int la = 0; la <= MAX_SHELL_L; ++la)
+        {
+            for (int lb = 0; lb <= MAX_SHELL_L; ++lb)
+            {
+                for (const auto &a : cartesian_shell_order(la))
+                {
+                    for (const auto &b : cartesian_shell_order(lb))
+                    {
+                        t[la][lb] += 12.0;
+                        for (int d = 0; d < 3; ++d)
+                            t[la][lb] += 5.0 * (a[d] + 1) * (b[d] + 1);
+                    }
+                }
+            }
+        }
+        return t;
+    }();
+
+    return table[La][Lb] * static_cast<double>(nprim_pairs);
+}
+
+std::vector<double> ObaraSaika::Overlap::computeOverlap(const Basis &basis, BatchDistribution distribution, RankLoad *load)
+{
+    // Build shell pairs (unique pairs only)
+    const auto shell_pairs = build_shell_pairs(basis);
+    return computeOverlap(basis, shell_pairs, distribution, load);
+}
+
+std::vector<double> ObaraSaika::Overlap::computeOverlap(const Basis &basis, const ShellPairList &shell_pairs, BatchDistribution distribution, RankLoad *load)
+{
+    const std::size_t nbf = basis.nbf();
+    const std::size_t nshells = basis.nshells();
 
     // Allocate overlap matrix (nbf × nbf)
     std::vector<double> S(nbf * nbf, 0.0);
 
-    // Build shell pairs (unique pairs only)
-    auto shell_pairs = build_shell_pairs(basis);
+    // Unique pairs with their cost estimates
+    const auto pair_tasks = build_shell_pair_tasks(basis);
+    std::vector<Task> tasks;
+    tasks.reserve(pair_tasks.size());
+    for (std::size_t t = 0; t < pair_tasks.size(); ++t)
+        tasks.push_back({t, pair_tasks[t].cost});
+
+    // Shell-pair block per thread, Cartesian on entry and in the final function basis after transform
+    std::vector<std::vector<double>> blocks(TaskPool::max_threads());
 
-    // Loop over all contracted basis functions
-    std::size_t mu_global = 0; // Global basis function index for shell i
-    for (std::size_t ishell = 0; ishell < nshells; ++ishell)
+    // Each task writes a disjoint block of S (and its mirror), so no
+    // synchronization is needed
+    auto compute_block = [&](const Task &task, int tid)
     {
+        const std::size_t ishell = pair_tasks[task.index].ishell;
+        const std::size_t jshell = pair_tasks[task.index].jshell;
+        std::vector<double> &block = blocks[tid];
+
         const auto &shell_i = basis.shells[ishell];
+        const auto &shell_j = basis.shells[jshell];
+        const auto cart_i = cartesian_shell_order(shell_i.L);
+        const auto cart_j = cartesian_shell_order(shell_j.L);
+
+        // Get shell pair (built with shell_i as A and shell_j as B since ishell <= jshell)
+        const auto &pair = shell_pairs[pair_index(ishell, jshell, nshells)];
 
-        // Get contracted functions for this shell
-        std::size_t nbf_i = 0;
-        for (const auto &bf : basis.functions)
+        // Compute overlaps for all Cartesian components of the two shells
+        block.assign(cart_i.size() * cart_j.size(), 0.0);
+        for (std::size_t a = 0; a < cart_i.size(); ++a)
         {
-            if (bf.shell == &shell_i)
-                ++nbf_i;
+            for (std::size_t b = 0; b < cart_j.size(); ++b)
+            {
+                block[a * cart_j.size() + b] = ObaraSaika::Overlap::computeContracted(cart_i[a], cart_j[b], pair);
+            }
         }
 
-        std::size_t nu_global = 0; // Global basis function index for shell j
-        for (std::size_t jshell = 0; jshell < nshells; ++jshell)
-        {
-            const auto &shell_j = basis.shells[jshell];
+        PLANCK_COUNT_COMPUTED(Profile::IntegralKind::Overlap, shell_i.L, shell_j.L, 0, 0, pair.nprimA * pair.nprimB,
+                              estimateFlops(shell_i.L, shell_j.L, pair.nprimA * pair.nprimB));
 
-            // Get shell pair
-            std::size_t pair_idx = pair_index(ishell, jshell, nshells);
-            const auto &pair = shell_pairs[pair_idx];
+        // Cartesian → solid harmonics for pure shells
+        transform_shell_block(shell_i, shell_j, block);
 
-            // Get contracted functions for shell j
-            std::size_t nbf_j = 0;
-            for (const auto &bf : basis.functions)
+        // Scatter into the (symmetric) matrix, row-major
+        const std::size_t mu_offset = basis.shell_offsets[ishell];
+        const std::size_t nu_offset = basis.shell_offsets[jshell];
+        const std::size_t nfun_i = shell_i.nfunctions();
+        const std::size_t nfun_j = shell_j.nfunctions();
+
+        for (std::size_t mu = 0; mu < nfun_i; ++mu)
+        {
+            for (std::size_t nu = 0; nu < nfun_j; ++nu)
             {
-                if (bf.shell == &shell_j)
-                    ++nbf_j;
+                const double overlap = block[mu * nfun_j + nu];
+                S[(mu_offset + mu) * nbf + (nu_offset + nu)] = overlap;
+                S[(nu_offset + nu) * nbf + (mu_offset + mu)] = overlap;
             }
+        }
+    };
 
-            // Compute overlaps for all function pairs in these shells
-            std::size_t mu_local = 0;
-            for (const auto &bf_a : basis.functions)
-            {
-                if (bf_a.shell != &shell_i)
-                    continue;
+    // Pair costs differ by orders of magnitude between s-s and d-d pairs with
+    // deep contractions, hence the cost-ordered, work-stealing schedule. With
+    // MPI every rank fills its own subset of the blocks and the allreduce
+    // completes the matrix.
+    const RankLoad rank_load = Distributed::run(std::move(tasks), distribution, compute_block);
+    if (distribution != BatchDistribution::Local)
+        Distributed::allreduce_sum(S);
 
-                std::size_t nu_local = 0;
-                for (const auto &bf_b : basis.functions)
-                {
-                    if (bf_b.shell != &shell_j)
-                        continue;
+    if (load)
+        *load = rank_load;
 
-                    // Compute S(μ,ν)
-                    double overlap = ObaraSaika::Overlap::computeContracted(bf_a, bf_b, pair);
+    return S;
+}
 
-                    // Store in matrix (row-major)
-                    std::size_t mu = mu_global + mu_local;
-                    std::size_t nu = nu_global + nu_local;
-                    S[mu * nbf + nu] = overlap;
+std::vector<double> ObaraSaika::Overlap::computeOverlapGradient(const Basis &basis, const ShellPairList &shell_pairs, std::span<const double> P, std::size_t natoms, BatchDistribution distribution)
+{
+    const std::size_t nbf = basis.nbf();
+    const std::size_t nshells = basis.nshells();
 
-                    ++nu_local;
-                }
-                ++mu_local;
+    const auto pair_tasks = build_shell_pair_tasks(basis);
+    std::vector<Task> tasks;
+    tasks.reserve(pair_tasks.size());
+    for (std::size_t t = 0; t < pair_tasks.size(); ++t)
+        tasks.push_back({t, pair_tasks[t].cost});
+
+    // Gradient and x, y, z derivative blocks per thread
+    const int nthreads = TaskPool::max_threads();
+    std::vector<std::vector<double>> gradients(nthreads, std::vector<double>(3 * natoms, 0.0));
+    std::vector<std::array<std::vector<double>, 3>> blocks(nthreads);
+
+    auto compute_block = [&](const Task &task, int tid)
+    {
+        const std::size_t ishell = pair_tasks[task.index].ishell;
+        const std::size_t jshell = pair_tasks[task.index].jshell;
+
+        const auto &shell_i = basis.shells[ishell];
+        const auto &shell_j = basis.shells[jshell];
+
+        // Moving both functions together leaves their overlap unchanged
+        // (this also covers every diagonal block)
+        if (shell_i.atom == shell_j.atom)
+            return;
+
+        const auto cart_i = cartesian_shell_order(shell_i.L);
+        const auto cart_j = cartesian_shell_order(shell_j.L);
+        const auto &pair = shell_pairs[pair_index(ishell, jshell, nshells)];
+        const auto expA = basis.exponents(shell_i);
+
+        auto &block = blocks[tid];
+        for (auto &component : block)
+            component.assign(cart_i.size() * cart_j.size(), 0.0);
+
+        for (std::size_t a = 0; a < cart_i.size(); ++a)
+        {
+            for (std::size_t b = 0; b < cart_j.size(); ++b)
+            {
+                const auto dS = computeContractedDerivative(cart_i[a], cart_j[b], pair, expA);
+                for (int d = 0; d < 3; ++d)
+                    block[d][a * cart_j.size() + b] = dS[d];
+            }
+        }
+
+        const std::size_t mu_offset = basis.shell_offsets[ishell];
+        const std::size_t nu_offset = basis.shell_offsets[jshell];
+        const std::size_t nfun_i = shell_i.nfunctions();
+        const std::size_t nfun_j = shell_j.nfunctions();
+
+        std::vector<double> &gradient = gradients[tid];
+        for (int d = 0; d < 3; ++d)
+        {
+            transform_shell_block(shell_i, shell_j, block[d]);
+
+            double sum = 0.0;
+            for (std::size_t mu = 0; mu < nfun_i; ++mu)
+            {
+                for (std::size_t nu = 0; nu < nfun_j; ++nu)
+                    sum += P[(mu_offset + mu) * nbf + (nu_offset + nu)] * block[d][mu * nfun_j + nu];
             }
 
-            nu_global += nbf_j;
+            // The unique pair stands for both triangles of P; ∂/∂B = -∂/∂A
+            gradient[3 * shell_i.atom + d] += 2.0 * sum;
+            gradient[3 * shell_j.atom + d] -= 2.0 * sum;
         }
+    };
+
+    Distributed::run(std::move(tasks), distribution, compute_block);
 
-        mu_global += nbf_i;
+    std::vector<double> gradient(3 * natoms, 0.0);
+    for (const auto &partial : gradients)
+    {
+        for (std::size_t k = 0; k < gradient.size(); ++k)
+            gradient[k] += partial[k];
     }
 
-    return S;
-}
\ No newline at end of file
+    if (distribution != BatchDistribution::Local)
+        Distributed::allreduce_sum(gradient);
+
+    return gradient;
+}
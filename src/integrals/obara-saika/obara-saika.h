@@ -2,6 +2,7 @@
 
 #include "base/base.h"
 #include "integrals/shell_pair.h"
+#include "parallel/distributed.h"
 
 /*-----------------------------------------------------------------------------
  * Planck
@@ -24,10 +25,26 @@ namespace ObaraSaika
 {
     namespace Overlap
     {
-        static double computePrimitive1D(int lA, int lB, double PA, double PB, double gamma);
+        double computePrimitive1D(int lA, int lB, double PA, double PB, double gamma);
         double computePrimtive3D(const std::array<int, 3> &am_a, const std::array<int, 3> &am_b, const ShellPair &pair, std::size_t prim_idx);
-        double computeContracted(const ContractedView &bf_a, const ContractedView &bf_b, const ShellPair &pair);
-        std::vector<double> computeOverlap(const Basis &basis);
+        double computeContracted(const std::array<int, 3> &am_a, const std::array<int, 3> &am_b, const ShellPair &pair);
+
+        // ∂/∂A of a contracted Cartesian overlap, with expA the exponents of
+        // shell A; ∂/∂B is its negative
+        std::array<double, 3> computeContractedDerivative(const std::array<int, 3> &am_a, const std::array<int, 3> &am_b, const ShellPair &pair, std::span<const double> expA);
+
+        // Estimated floating-point operations of one Cartesian shell-pair block
+        double estimateFlops(int La, int Lb, std::size_t nprim_pairs);
+
+        std::vector<double> computeOverlap(const Basis &basis, BatchDistribution distribution = BatchDistribution::Dynamic, RankLoad *load = nullptr);
+
+        // Same, with shell pairs built by the caller (and possibly reused across geometries)
+        std::vector<double> computeOverlap(const Basis &basis, const ShellPairList &shell_pairs, BatchDistribution distribution = BatchDistribution::Dynamic, RankLoad *load = nullptr);
+
+        // Σ_μν P_μν ∂S_μν/∂R for every atom (3 × natoms), with P a symmetric
+        // row-major nbf × nbf matrix. Each shell-pair derivative block is
+        // contracted with P as soon as it is computed; ∂S is never stored.
+        std::vector<double> computeOverlapGradient(const Basis &basis, const ShellPairList &shell_pairs, std::span<const double> P, std::size_t natoms, BatchDistribution distribution = BatchDistribution::Dynamic);
     };
 
     namespace Kinetic
@@ -1,6 +1,7 @@
 #include "shell_pair.h"
 #include "math/math.h"
 
+#include <algorithm>
 #include <cmath>
 
 /*-----------------------------------------------------------------------------
@@ -20,24 +21,43 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  ----------------------------------------------------------------------------*/
 
-ShellPair::ShellPair(const Shell &shellA, const Shell &shellB) : shellA(shellA), shellB(shellB), tot_momentumA(shellA.L), tot_momentumB(shellB.L), centerA(shellA.center), centerB(shellB.center)
+ShellPair::ShellPair(const Basis &basis, std::size_t shellA, std::size_t shellB) : shellA(shellA), shellB(shellB),
+                                                                                    nprimA(basis.shells[shellA].nprimitives()), nprimB(basis.shells[shellB].nprimitives()),
+                                                                                    tot_momentumA(basis.shells[shellA].L), tot_momentumB(basis.shells[shellB].L),
+                                                                                    centerA(basis.shells[shellA].center), centerB(basis.shells[shellB].center)
 {
     // Compute distance vector AB
     AB = {
         centerA[0] - centerB[0],
         centerA[1] - centerB[1],
         centerA[2] - centerB[2]};
+}
 
-    // Number of primitive pairs
-    const std::size_t na = shellA.exponents.size();
-    const std::size_t nb = shellB.exponents.size();
+std::size_t ShellPair::storage_size() const noexcept
+{
+    // alpha, prefac, Px, Py, Pz for every primitive pair
+    return 5 * nprimA * nprimB;
+}
 
-    // Allocate storage for all primitive pairs
-    alpha.reserve(na * nb);
-    prefac.reserve(na * nb);
-    Px.reserve(na * nb);
-    Py.reserve(na * nb);
-    Pz.reserve(na * nb);
+void ShellPair::compute_primitive_pairs(const Basis &basis, std::span<double> storage)
+{
+    // Number of primitive pairs
+    const std::size_t na = nprimA;
+    const std::size_t nb = nprimB;
+    const std::size_t nab = na * nb;
+
+    // Primitive data of the two shells
+    const Shell &A = basis.shells[shellA];
+    const Shell &B = basis.shells[shellB];
+    const auto expA = basis.exponents(A), coefA = basis.coefficients(A), normA = basis.prim_norms(A);
+    const auto expB = basis.exponents(B), coefB = basis.coefficients(B), normB = basis.prim_norms(B);
+
+    // Carve the storage into SoA arrays
+    std::span<double> alpha_out = storage.subspan(0 * nab, nab);
+    std::span<double> prefac_out = storage.subspan(1 * nab, nab);
+    std::span<double> Px_out = storage.subspan(2 * nab, nab);
+    std::span<double> Py_out = storage.subspan(3 * nab, nab);
+    std::span<double> Pz_out = storage.subspan(4 * nab, nab);
 
     // Distance squared |AB|**2
     const double AB2 = dot_product(AB, AB);
@@ -45,70 +65,177 @@ ShellPair::ShellPair(const Shell &shellA, const Shell &shellB) : shellA(shellA),
     // Precompute data for each primitive pair (i,j)
     for (std::size_t i = 0; i < na; ++i)
     {
-        const double ai = shellA.exponents[i];
-        const double ni = shellA.prim_norms[i];
-        const double ci = shellA.coefficients[i];
+        const double ai = expA[i];
+        const double ni = normA[i];
+        const double ci = coefA[i];
 
         for (std::size_t j = 0; j < nb; ++j)
         {
-            const double bj = shellB.exponents[j];
-            const double nj = shellB.prim_norms[j];
-            const double cj = shellB.coefficients[j];
+            const double bj = expB[j];
+            const double nj = normB[j];
+            const double cj = coefB[j];
+            const std::size_t ij = i * nb + j;
 
             // 1. Combined exponent: α_ij = α_i + β_j
             const double a = ai + bj;
-            alpha.push_back(a);
+            alpha_out[ij] = a;
 
             // 2. Prefactor includes:
             //    - Gaussian product theorem: exp(-α_i*β_j*|AB|²/(α_i+β_j))
             //    - Contraction coefficients: c_i * d_j
             //    - Primitive normalizations: N_i * N_j
             const double mu = ai * bj / a;
-            prefac.push_back(ci * cj * ni * nj * std::exp(-1 * mu * AB2));
+            prefac_out[ij] = ci * cj * ni * nj * std::exp(-1 * mu * AB2);
 
             // 3. Gaussian product center P = (α_i * A + β_j * B) / α_ij
-            Px.push_back((ai * centerA[0] + bj * centerB[0]) / a);
-            Py.push_back((ai * centerA[1] + bj * centerB[1]) / a);
-            Pz.push_back((ai * centerA[2] + bj * centerB[2]) / a);
+            Px_out[ij] = (ai * centerA[0] + bj * centerB[0]) / a;
+            Py_out[ij] = (ai * centerA[1] + bj * centerB[1]) / a;
+            Pz_out[ij] = (ai * centerA[2] + bj * centerB[2]) / a;
         }
     }
+
+    bind_primitive_pairs(storage);
+}
+
+void ShellPair::bind_primitive_pairs(std::span<const double> storage)
+{
+    const std::size_t nab = nprimA * nprimB;
+
+    alpha = storage.subspan(0 * nab, nab);
+    prefac = storage.subspan(1 * nab, nab);
+    Px = storage.subspan(2 * nab, nab);
+    Py = storage.subspan(3 * nab, nab);
+    Pz = storage.subspan(4 * nab, nab);
+}
+
+// A pair can take over the data of the same pair at an earlier geometry if
+// neither of its centers moved (the shells themselves are identical)
+static bool same_geometry(const ShellPair &pair, const ShellPair &old) noexcept
+{
+    return pair.centerA == old.centerA && pair.centerB == old.centerB &&
+           pair.storage_size() == old.storage_size();
 }
 
-std::vector<ShellPair> build_shell_pairs(const Basis &basis)
+// Allocate one arena for all pairs and fill it with a first-touch schedule.
+// `tasks` (Task::index = pair) is the task list of the loop that reads the
+// pairs. The arena holds the pairs thread by thread in the order the pool
+// deals that list, so the pages of every thread are its own.
+static void fill_primitive_pairs(const Basis &basis, ShellPairList &list, std::vector<Task> tasks, const ShellPairList *previous = nullptr)
+{
+    std::vector<std::size_t> offsets(list.pairs.size(), 0);
+    std::size_t arena_size = 0;
+    for (const auto &positions : TaskPool::deal(tasks))
+    {
+        for (std::size_t i : positions)
+        {
+            const std::size_t p = tasks[i].index;
+            offsets[p] = arena_size;
+            arena_size += list.pairs[p].storage_size();
+        }
+    }
+
+    list.arena = numa_vector<double>(arena_size);
+
+    const bool can_reuse = previous && previous->size() == list.size();
+    std::vector<char> reused(list.size(), 0);
+
+    Numa::first_touch(std::move(tasks), [&](const Task &task)
+                      {
+        const std::size_t p = task.index;
+        const std::span<double> storage(list.arena.data() + offsets[p], list.pairs[p].storage_size());
+        ShellPair &pair = list.pairs[p];
+
+        if (can_reuse && same_geometry(pair, (*previous)[p]))
+        {
+            // alpha is the start of the pair's block in the previous arena
+            std::copy_n(previous->pairs[p].alpha.data(), storage.size(), storage.begin());
+            pair.bind_primitive_pairs(storage);
+            reused[p] = 1;
+        }
+        else
+        {
+            pair.compute_primitive_pairs(basis, storage);
+        } });
+
+    list.reused = static_cast<std::size_t>(std::count(reused.begin(), reused.end(), 1));
+}
+
+ShellPairList build_shell_pairs(const Basis &basis, const ShellPairList *previous)
 {
     std::size_t nshells = basis.nshells();
-    std::vector<ShellPair> pairs;
+    ShellPairList list;
 
     // Reserve space for unique pairs: N*(N+1)/2
-    pairs.reserve(nshells * (nshells + 1) / 2);
+    list.pairs.reserve(nshells * (nshells + 1) / 2);
 
     // Build only unique pairs (i,j) where i <= j
     for (std::size_t i = 0; i < nshells; ++i)
     {
         for (std::size_t j = i; j < nshells; ++j)
         {
-            pairs.emplace_back(basis.shells[i], basis.shells[j]);
+            list.pairs.emplace_back(basis, i, j);
         }
     }
 
-    return pairs;
+    // Same tasks, in the same order, as the loops over build_shell_pair_tasks
+    std::vector<Task> tasks;
+    for (const ShellPairTask &task : build_shell_pair_tasks(basis))
+        tasks.push_back({pair_index(task.ishell, task.jshell, nshells), task.cost});
+
+    fill_primitive_pairs(basis, list, std::move(tasks), previous);
+    return list;
 }
 
-std::vector<ShellPair> build_shell_pairs_matrix(const Basis &basis)
+ShellPairList build_shell_pairs_matrix(const Basis &basis)
 {
     std::size_t nshells = basis.nshells();
-    std::vector<ShellPair> pairs;
+    ShellPairList list;
 
     // Reserve space for all pairs
-    pairs.reserve(nshells * nshells);
+    list.pairs.reserve(nshells * nshells);
 
     for (std::size_t i = 0; i < nshells; ++i)
     {
         for (std::size_t j = 0; j < nshells; ++j)
         {
-            pairs.emplace_back(basis.shells[i], basis.shells[j]);
+            list.pairs.emplace_back(basis, i, j);
         }
     }
 
-    return pairs;
-}
\ No newline at end of file
+    std::vector<Task> tasks;
+    for (std::size_t p = 0; p < list.pairs.size(); ++p)
+        tasks.push_back({p, static_cast<double>(list.pairs[p].storage_size())});
+
+    fill_primitive_pairs(basis, list, std::move(tasks));
+    return list;
+}
+
+std::vector<ShellPairTask> build_shell_pair_tasks(const Basis &basis)
+{
+    const std::size_t nshells = basis.nshells();
+    std::vector<ShellPairTask> tasks;
+    tasks.reserve(nshells * (nshells + 1) / 2);
+
+    for (std::size_t i = 0; i < nshells; ++i)
+    {
+        const Shell &shellA = basis.shells[i];
+
+        for (std::size_t j = i; j < nshells; ++j)
+        {
+            const Shell &shellB = basis.shells[j];
+
+            // primitive pairs × Cartesian component pairs × length of the 1D recursion
+            const double cost = static_cast<double>(shellA.nprimitives() * shellB.nprimitives()) *
+                                static_cast<double>(shellA.ncartesian() * shellB.ncartesian()) *
+                                static_cast<double>(shellA.L + shellB.L + 1);
+
+            tasks.push_back({i, j, cost});
+        }
+    }
+
+    // Most expensive pairs first, so the cheap ones fill in the tail of the loop
+    std::stable_sort(tasks.begin(), tasks.end(), [](const ShellPairTask &a, const ShellPairTask &b)
+                     { return a.cost > b.cost; });
+
+    return tasks;
+}
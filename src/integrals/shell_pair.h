@@ -2,8 +2,10 @@
 
 #include <cstddef>   
 #include <algorithm> 
+#include <span>
 
 #include "base/base.h"
+#include "parallel/numa.h"
 
 /*-----------------------------------------------------------------------------
  * Planck
@@ -24,9 +26,13 @@
 
 struct ShellPair
 {
-    // pointers to Shells
-    const Shell &shellA;
-    const Shell &shellB;
+    // Indices of the shells in Basis::shells
+    std::size_t shellA;
+    std::size_t shellB;
+
+    // Primitives per shell
+    std::size_t nprimA;
+    std::size_t nprimB;
 
     // L values
     int tot_momentumA;
@@ -39,16 +45,67 @@ struct ShellPair
     // Distance vector AB
     std::array<double, 3> AB;
 
-    // Precomputed primitive-pair data
-    std::vector<double> alpha; // α_i + β_j
-    std::vector<double> prefac;
-    std::vector<double> Px, Py, Pz;
+    // Precomputed primitive-pair data (views into the ShellPairList arena)
+    std::span<const double> alpha; // α_i + β_j
+    std::span<const double> prefac;
+    std::span<const double> Px, Py, Pz;
+
+    ShellPair(const Basis &basis, std::size_t shellA, std::size_t shellB);
+
+    // Doubles of primitive-pair data this pair needs in the arena
+    std::size_t storage_size() const noexcept;
+
+    // Compute the primitive-pair data into `storage` (storage_size() doubles)
+    void compute_primitive_pairs(const Basis &basis, std::span<double> storage);
 
-    ShellPair(const Shell &shellA, const Shell &shellB);
+    // Point the views at primitive-pair data that is already computed
+    void bind_primitive_pairs(std::span<const double> storage);
 };
 
-std::vector<ShellPair> build_shell_pairs(const Basis &basis);
-std::vector<ShellPair> build_shell_pairs_matrix(const Basis &basis);
+// Shell pairs together with the arena that holds their primitive-pair data
+// The arena is one NUMA-aware allocation filled in parallel, so its pages are
+// spread over the nodes of the threads that build (and later read) it.
+struct ShellPairList
+{
+    numa_vector<double> arena;
+    std::vector<ShellPair> pairs;
+    std::size_t reused = 0; // pairs copied from a previous geometry
+
+    ShellPairList() = default;
+    ShellPairList(ShellPairList &&) noexcept = default;
+    ShellPairList &operator=(ShellPairList &&) noexcept = default;
+
+    // Spans point into arena, so copies would alias the original
+    ShellPairList(const ShellPairList &) = delete;
+    ShellPairList &operator=(const ShellPairList &) = delete;
+
+    const ShellPair &operator[](std::size_t index) const noexcept
+    {
+        return pairs[index];
+    }
+
+    std::size_t size() const noexcept
+    {
+        return pairs.size();
+    }
+};
+
+// Unique shell pair (ishell <= jshell) with an estimate of the cost of its integrals
+struct ShellPairTask
+{
+    std::size_t ishell;
+    std::size_t jshell;
+    double cost;
+};
+
+// With `previous` (same basis at an earlier geometry, e.g. the last point of a
+// scan), pairs whose two centers did not move copy their primitive-pair data
+// instead of recomputing it
+ShellPairList build_shell_pairs(const Basis &basis, const ShellPairList *previous = nullptr);
+
+// Unique shell pairs ordered by descending cost, for dynamic scheduling
+std::vector<ShellPairTask> build_shell_pair_tasks(const Basis &basis);
+ShellPairList build_shell_pairs_matrix(const Basis &basis);
 
 // Compute the shell pair index for (i,j) given total number of shells
 inline std::size_t pair_index(std::size_t i, std::size_t j, std::size_t nshells)
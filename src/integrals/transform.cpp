@@ -0,0 +1,74 @@
+#include "transform.h"
+#include "basis/basis.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+void transform_shell_block(const Shell &shellA, const Shell &shellB, std::vector<double> &block)
+{
+    if (!shellA.pure && !shellB.pure)
+        return;
+
+    const std::size_t ncartA = shellA.ncartesian();
+    const std::size_t ncartB = shellB.ncartesian();
+    const std::size_t nfunA = shellA.nfunctions();
+    const std::size_t nfunB = shellB.nfunctions();
+
+    // Left transform: (nfunA × ncartA) · (ncartA × ncartB)
+    std::vector<double> half;
+    if (shellA.pure)
+    {
+        const auto &T = cartesian_to_spherical(shellA.L);
+        half.assign(nfunA * ncartB, 0.0);
+
+        for (std::size_t p = 0; p < nfunA; ++p)
+            for (std::size_t a = 0; a < ncartA; ++a)
+            {
+                const double t = T[p * ncartA + a];
+                if (t == 0.0)
+                    continue;
+
+                for (std::size_t b = 0; b < ncartB; ++b)
+                    half[p * ncartB + b] += t * block[a * ncartB + b];
+            }
+    }
+    else
+    {
+        half = std::move(block);
+    }
+
+    // Right transform: (nfunA × ncartB) · (ncartB × nfunB)
+    if (shellB.pure)
+    {
+        const auto &T = cartesian_to_spherical(shellB.L);
+        block.assign(nfunA * nfunB, 0.0);
+
+        for (std::size_t p = 0; p < nfunA; ++p)
+            for (std::size_t q = 0; q < nfunB; ++q)
+            {
+                double value = 0.0;
+                for (std::size_t b = 0; b < ncartB; ++b)
+                    value += half[p * ncartB + b] * T[q * ncartB + b];
+
+                block[p * nfunB + q] = value;
+            }
+    }
+    else
+    {
+        block = std::move(half);
+    }
+}
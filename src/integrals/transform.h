@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include "base/base.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Transform one shell-pair block from Cartesian components to the functions
+// carried by the two shells. On input `block` is row-major
+// (ncartesian(A) × ncartesian(B)); on output it is (nfunctions(A) × nfunctions(B)).
+// Blocks between two Cartesian shells are left untouched.
+void transform_shell_block(const Shell &shellA, const Shell &shellB, std::vector<double> &block);
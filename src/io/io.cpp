@@ -6,11 +6,16 @@
 #include <functional>
 #include <expected>
 #include <algorithm>
-#include <sstream>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <cctype>
 
 #include "base/basis.h"
 #include "io.h"
+#include "mapped_file.h"
+#include "text.h"
 #include "lookup/elements.h"
 #include <numeric>
 
@@ -31,21 +36,6 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  ----------------------------------------------------------------------------*/
 
-using SectionMap = std::unordered_map<std::string, std::vector<std::string>>;
-
-static void trim(std::string &s)
-{
-    const auto first = s.find_first_not_of(" \t");
-    if (first == std::string::npos)
-    {
-        s.clear();
-        return;
-    }
-
-    const auto last = s.find_last_not_of(" \t");
-    s = s.substr(first, last - first + 1);
-}
-
 std::string toLower(const std::string &parsedString)
 {
     std::string lowerString = parsedString; // Create a copy to preserve the original string
@@ -70,6 +60,39 @@ IntegralEngine stringtoEnum(const std::string &parsedString)
     return it->second;
 }
 
+BatchDistribution stringToDistribution(const std::string &parsedString)
+{
+    const std::unordered_map<std::string, BatchDistribution> map = {
+        {"ROUNDROBIN", BatchDistribution::RoundRobin},
+        {"DYNAMIC", BatchDistribution::Dynamic}};
+
+    auto it = map.find(parsedString);
+
+    if (it == map.end())
+    {
+        throw std::invalid_argument("Invalid batch distribution specified");
+    }
+
+    return it->second;
+}
+
+NumaPolicy stringToNumaPolicy(const std::string &parsedString)
+{
+    const std::unordered_map<std::string, NumaPolicy> map = {
+        {"OFF", NumaPolicy::Off},
+        {"FIRST_TOUCH", NumaPolicy::FirstTouch},
+        {"INTERLEAVE", NumaPolicy::Interleave}};
+
+    auto it = map.find(parsedString);
+
+    if (it == map.end())
+    {
+        throw std::invalid_argument("Invalid NUMA policy specified");
+    }
+
+    return it->second;
+}
+
 bool stringToBool(const std::string &parsedString)
 {
     std::string upperStr = parsedString;
@@ -122,17 +145,18 @@ std::expected<void, std::string> check_charge_multiplicity(const Molecule &molec
     return {}; // success
 }
 
-std::expected<SectionMap, std::string> split_into_sections(std::istream &input)
+std::expected<SectionMap, std::string> split_into_sections(std::string_view text)
 {
     SectionMap sections;
 
-    std::string line;
-    std::string current;
-    bool in_section = false;
+    Text::LineCursor cursor(text);
+    std::string_view line;
+    std::vector<std::string_view> *current = nullptr;
+    std::string current_name;
 
-    while (std::getline(input, line))
+    while (cursor.next(line))
     {
-        trim(line);
+        line = Text::trim(line);
 
         if (line.empty() || line.front() == '#')
             continue;
@@ -140,42 +164,41 @@ std::expected<SectionMap, std::string> split_into_sections(std::istream &input)
         // Section header?
         if (line.front() == '[' && line.back() == ']')
         {
-            const std::string tag = line.substr(1, line.size() - 2);
+            const std::string_view tag = line.substr(1, line.size() - 2);
 
             // END tag
             if (tag.starts_with("END "))
             {
-                const std::string end_name = tag.substr(4);
+                const std::string end_name(tag.substr(4));
 
-                if (!in_section)
+                if (!current)
                     return std::unexpected("END without active section: " + end_name);
 
-                if (end_name != current)
-                    return std::unexpected("Mismatched END section. Expected END " + current + ", got END " + end_name);
+                if (end_name != current_name)
+                    return std::unexpected("Mismatched END section. Expected END " + current_name + ", got END " + end_name);
 
-                current.clear();
-                in_section = false;
+                current = nullptr;
+                current_name.clear();
                 continue;
             }
 
             // START tag
-            if (in_section)
-                return std::unexpected("Nested section [" + tag + "] inside [" + current + "]");
+            if (current)
+                return std::unexpected("Nested section [" + std::string(tag) + "] inside [" + current_name + "]");
 
-            current = tag;
-            in_section = true;
-            sections[current]; // create entry
+            current_name = std::string(tag);
+            current = &sections[current_name]; // create entry
             continue;
         }
 
-        if (in_section)
+        if (current)
         {
-            sections[current].push_back(line);
+            current->push_back(line);
         }
     }
 
-    if (in_section)
-        return std::unexpected("Unterminated section: " + current);
+    if (current)
+        return std::unexpected("Unterminated section: " + current_name);
 
     if (sections.empty())
         return std::unexpected("No sections found in input");
@@ -183,57 +206,181 @@ std::expected<SectionMap, std::string> split_into_sections(std::istream &input)
     return sections;
 }
 
-std::expected<Molecule, std::string> parse_geometry(const std::vector<std::string> &lines)
+// Leading count of a geometry block or XYZ frame
+static bool parse_atom_count(std::string_view line, std::size_t &natoms)
 {
-    if (lines.empty())
-        return std::unexpected("Empty GEOM section");
+    const std::string_view token = Text::next_token(line);
+    return Text::parse_number(token, natoms) && natoms > 0;
+}
 
-    std::size_t natoms = 0;
+// Coordinate in the forms istream accepted, including a leading '+'
+static bool parse_coordinate(std::string_view token, double &value)
+{
+    if (token.size() > 1 && token.front() == '+')
+        token.remove_prefix(1);
+
+    return Text::parse_number(token, value);
+}
+
+// "<symbol> <x> <y> <z>" into atom i of mol; further columns are ignored
+static std::expected<void, std::string> parse_atom_line(std::string_view line, std::size_t i, Molecule &mol, const char *source)
+{
+    std::string_view rest = line;
+    const std::string_view symbol = Text::next_token(rest);
+
+    double xyz[3];
+    for (double &x : xyz)
     {
-        std::istringstream iss(lines[0]);
-        if (!(iss >> natoms) || natoms == 0)
-            return std::unexpected("Invalid atom count in GEOM section");
+        if (!parse_coordinate(Text::next_token(rest), x))
+            return std::unexpected("Malformed " + std::string(source) + " line: " + std::string(line));
     }
 
-    if (lines.size() != natoms + 1)
-        return std::unexpected("GEOM atom count does not match number of lines");
+    try
+    {
+        const auto &el = element_from_symbol(symbol);
+        mol.atomic_numbers[i] = el.Z;
+        mol.atomic_masses[i] = el.mass;
+    }
+    catch (...)
+    {
+        return std::unexpected("Unknown atomic symbol: " + std::string(symbol));
+    }
 
-    Molecule mol;
+    mol.coordinates[3 * i + 0] = xyz[0];
+    mol.coordinates[3 * i + 1] = xyz[1];
+    mol.coordinates[3 * i + 2] = xyz[2];
+
+    return {};
+}
+
+static void resize_molecule(Molecule &mol, std::size_t natoms)
+{
     mol.natoms = natoms;
     mol.atomic_numbers.resize(natoms);
     mol.atomic_masses.resize(natoms);
     mol.coordinates.resize(3 * natoms);
+}
+
+std::expected<Molecule, std::string> parse_geometry(std::span<const std::string_view> lines)
+{
+    if (lines.empty())
+        return std::unexpected("Empty GEOM section");
+
+    std::size_t natoms = 0;
+    if (!parse_atom_count(lines[0], natoms))
+        return std::unexpected("Invalid atom count in GEOM section");
+
+    if (lines.size() != natoms + 1)
+        return std::unexpected("GEOM atom count does not match number of lines");
+
+    Molecule mol;
+    resize_molecule(mol, natoms);
 
     for (std::size_t i = 0; i < natoms; ++i)
     {
-        std::istringstream iss(lines[i + 1]);
+        if (auto atom = parse_atom_line(lines[i + 1], i, mol, "GEOM"); !atom)
+            return std::unexpected(atom.error());
+    }
 
-        std::string symbol;
-        double x, y, z;
+    return mol;
+}
 
-        if (!(iss >> symbol >> x >> y >> z))
-            return std::unexpected("Malformed GEOM line: " + lines[i + 1]);
+// Collect the frames of a scan into one Molecule (frame 0 as its geometry)
+static std::expected<Molecule, std::string> merge_frames(std::vector<Molecule> &frames)
+{
+    if (frames.empty())
+        return std::unexpected("No geometries found for scan");
 
-        try
-        {
-            const auto &el = element_from_symbol(symbol);
-            mol.atomic_numbers[i] = el.Z;
-            mol.atomic_masses[i] = el.mass;
-        }
-        catch (...)
+    Molecule mol = frames.front();
+    for (std::size_t f = 0; f < frames.size(); ++f)
+    {
+        if (frames[f].atomic_numbers != mol.atomic_numbers)
+            return std::unexpected("Scan frame " + std::to_string(f + 1) + " has different atoms than frame 1");
+
+        mol.scan_frames.push_back(std::move(frames[f].coordinates));
+    }
+
+    return mol;
+}
+
+std::expected<Molecule, std::string> parse_geometry_frames(std::span<const std::string_view> lines)
+{
+    // Frames follow each other: atom count, then one line per atom
+    std::vector<Molecule> frames;
+    std::size_t line = 0;
+
+    while (line < lines.size())
+    {
+        std::size_t natoms = 0;
+        if (!parse_atom_count(lines[line], natoms))
+            return std::unexpected("Invalid atom count in GEOM section: " + std::string(lines[line]));
+
+        if (line + natoms + 1 > lines.size())
+            return std::unexpected("Truncated frame in GEOM section");
+
+        auto frame = parse_geometry(lines.subspan(line, natoms + 1));
+        if (!frame)
+            return std::unexpected(frame.error());
+
+        frames.push_back(std::move(*frame));
+        line += natoms + 1;
+    }
+
+    return merge_frames(frames);
+}
+
+std::expected<Molecule, std::string> parse_xyz_frames(std::string_view text)
+{
+    // Standard multi-frame XYZ: atom count, comment line, one line per atom
+    std::vector<Molecule> frames;
+    Text::LineCursor cursor(text);
+    std::string_view line;
+
+    while (cursor.next(line))
+    {
+        line = Text::trim(line);
+        if (line.empty())
+            continue;
+
+        std::size_t natoms = 0;
+        if (!parse_atom_count(line, natoms))
+            return std::unexpected("Invalid atom count in XYZ file: " + std::string(line));
+
+        // comment line
+        if (!cursor.next(line))
+            return std::unexpected("Truncated frame in XYZ file");
+
+        Molecule frame;
+        resize_molecule(frame, natoms);
+
+        for (std::size_t i = 0; i < natoms; ++i)
         {
-            return std::unexpected("Unknown atomic symbol: " + symbol);
+            if (!cursor.next(line))
+                return std::unexpected("Truncated frame in XYZ file");
+
+            if (auto atom = parse_atom_line(line, i, frame, "XYZ"); !atom)
+                return std::unexpected(atom.error());
         }
 
-        mol.coordinates[3 * i + 0] = x;
-        mol.coordinates[3 * i + 1] = y;
-        mol.coordinates[3 * i + 2] = z;
+        frames.push_back(std::move(frame));
     }
 
-    return mol;
+    if (frames.empty())
+        return std::unexpected("No geometries found in XYZ file");
+
+    return merge_frames(frames);
 }
 
-std::expected<Calculator, std::string> parse_calculator(const std::vector<std::string> &lines)
+std::expected<Molecule, std::string> read_xyz_file(const std::string &filename)
+{
+    auto file = MappedFile::open(filename);
+    if (!file)
+        return std::unexpected("Unable to read XYZ file: " + file.error());
+
+    return parse_xyz_frames(file->text());
+}
+
+std::expected<Calculator, std::string> parse_calculator(std::span<const std::string_view> lines)
 {
     if (lines.size() < 2)
     {
@@ -248,7 +395,11 @@ std::expected<Calculator, std::string> parse_calculator(const std::vector<std::s
         {"CALC_TYPE",   [&calc](std::string value){ calc.calc_type          = toLower(value); }},
         {"THEORY",      [&calc](std::string value){ calc.method             = toLower(value); }},
         {"BASIS",       [&calc](std::string value){ calc.basis_name         = toLower(value); }},
+        {"BASIS_TYPE",  [&calc](std::string value){ calc.basis_type         = toLower(value); }},
+        {"SCAN_FILE",   [&calc](std::string value){ calc.scan_file          = value; }},
         {"ROUTINE",     [&calc](std::string value){ calc.integral_engine    = stringtoEnum(value); }},
+        {"MPI_SCHED",   [&calc](std::string value){ calc.batch_distribution = stringToDistribution(value); }},
+        {"NUMA",        [&calc](std::string value){ calc.numa_policy        = stringToNumaPolicy(value); }},
 
         // diis and symmetry information
         {"USE_SYMM",    [&calc](std::string value){ calc.use_pgsymmetry = stringToBool(value); }},
@@ -266,16 +417,23 @@ std::expected<Calculator, std::string> parse_calculator(const std::vector<std::s
         {"TOLERI",      [&calc](std::string value){ calc.tol_eri   = std::stod(value); }}
         };
 
-    for (auto line : lines)
+    for (std::string_view line : lines)
     {
-        std::istringstream iss(line);
-        std::string key, value;
+        const std::string key(Text::next_token(line));
+        const std::string value(Text::next_token(line));
 
-        if (!(iss >> key >> value))
+        if (key.empty() || value.empty())
         {
             return std::unexpected("Malformed Input line");
         }
 
+        // Refuse keys of features that are not implemented yet rather than
+        // accepting them and silently doing nothing
+        if (key == "ADAPT_ERI" || key == "TOLERI_INIT" || key == "ERI_FP32")
+        {
+            return std::unexpected(key + " is not supported yet");
+        }
+
         // search for the key in map
         auto it = handlers_setup.find(key);
 
@@ -291,27 +449,50 @@ std::expected<Calculator, std::string> parse_calculator(const std::vector<std::s
     if (calc.multiplicity <= 0)
         return std::unexpected("Invalid spin multiplicity");
 
+    // Only single points and scans are implemented (an unset type is a single point)
+    if (!calc.calc_type.empty() && calc.calc_type != "energy" && calc.calc_type != "scan")
+        return std::unexpected("CALC_TYPE " + calc.calc_type + " is not supported yet");
+
+    if (calc.basis_type != "cartesian" && calc.basis_type != "spherical")
+        return std::unexpected("Invalid basis type: " + calc.basis_type);
+
+#ifndef PLANCK_HAVE_LIBNUMA
+    if (calc.numa_policy == NumaPolicy::Interleave)
+        return std::unexpected("NUMA INTERLEAVE needs a build with libnuma");
+#endif
+
     calc.basis_path = get_basis_path();
     return calc;
 }
 
-std::expected<void, std::string> read_input(std::istream &input, Calculator &calc, Molecule &mol)
+// Relative paths in an input are taken from the directory of the input file
+static std::string resolve_path(const std::string &path, const std::string &directory)
 {
-    if (!input)
-        return std::unexpected("Invalid input stream");
+    const std::filesystem::path p(path);
+    if (p.is_absolute() || directory.empty())
+        return path;
 
-    auto sections = split_into_sections(input);
-    if (!sections)
-        return std::unexpected(sections.error());
+    return (std::filesystem::path(directory) / p).string();
+}
 
-    // GEOM
-    auto geom_it = sections->find("GEOM");
-    if (geom_it == sections->end())
-        return std::unexpected("Missing required [GEOM] section");
+// Geometry named by a [GEOM] block of the form "XYZ_FILE <path>"
+static std::optional<std::string> external_geometry(std::span<const std::string_view> lines)
+{
+    if (lines.size() != 1)
+        return std::nullopt;
 
-    auto geom = parse_geometry(geom_it->second);
-    if (!geom)
-        return std::unexpected(geom.error());
+    std::string_view rest = lines[0];
+    if (Text::next_token(rest) != "XYZ_FILE")
+        return std::nullopt;
+
+    return std::string(Text::next_token(rest));
+}
+
+std::expected<void, std::string> read_input(std::string_view text, const std::string &directory, Calculator &calc, Molecule &mol)
+{
+    auto sections = split_into_sections(text);
+    if (!sections)
+        return std::unexpected(sections.error());
 
     // CALC
     auto calc_it = sections->find("CALC");
@@ -322,6 +503,44 @@ std::expected<void, std::string> read_input(std::istream &input, Calculator &cal
     if (!calc_parsed)
         return std::unexpected(calc_parsed.error());
 
+    // GEOM (a scan reads its frames from [GEOM] or from SCAN_FILE; either may
+    // be a multi-frame XYZ file)
+    const bool is_scan = (calc_parsed->calc_type == "scan");
+    std::expected<Molecule, std::string> geom;
+
+    if (is_scan && !calc_parsed->scan_file.empty())
+    {
+        calc_parsed->scan_file = resolve_path(calc_parsed->scan_file, directory);
+        geom = read_xyz_file(calc_parsed->scan_file);
+    }
+    else
+    {
+        auto geom_it = sections->find("GEOM");
+        if (geom_it == sections->end())
+            return std::unexpected("Missing required [GEOM] section");
+
+        if (auto xyz_file = external_geometry(geom_it->second))
+        {
+            if (xyz_file->empty())
+                return std::unexpected("XYZ_FILE needs a file name");
+
+            geom = read_xyz_file(resolve_path(*xyz_file, directory));
+            if (geom && !is_scan && geom->scan_frames.size() > 1)
+                return std::unexpected("XYZ file " + *xyz_file + " holds " + std::to_string(geom->scan_frames.size()) + " geometries, only SCAN calculations take several");
+
+            // A single point keeps its one geometry in coordinates only
+            if (geom && !is_scan)
+                geom->scan_frames.clear();
+        }
+        else
+        {
+            geom = is_scan ? parse_geometry_frames(geom_it->second) : parse_geometry(geom_it->second);
+        }
+    }
+
+    if (!geom)
+        return std::unexpected(geom.error());
+
     // check if charge and multiplicity match
     if (auto checks = check_charge_multiplicity(*geom, *calc_parsed); !checks)
     {
@@ -333,3 +552,13 @@ std::expected<void, std::string> read_input(std::istream &input, Calculator &cal
 
     return {};
 }
+
+std::expected<void, std::string> read_input_file(const std::string &filename, Calculator &calc, Molecule &mol)
+{
+    auto file = MappedFile::open(filename);
+    if (!file)
+        return std::unexpected(file.error());
+
+    // Views into the mapping only live while parsing, the results own their data
+    return read_input(file->text(), std::filesystem::path(filename).parent_path().string(), calc, mol);
+}
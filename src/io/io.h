@@ -1,7 +1,8 @@
 #pragma once
 
-#include <istream>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <expected>
@@ -25,9 +26,20 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  ----------------------------------------------------------------------------*/
 
-using SectionMap = std::unordered_map<std::string, std::vector<std::string>>;
+// Lines of each section, as views into the input text
+using SectionMap = std::unordered_map<std::string, std::vector<std::string_view>>;
 
-std::expected<SectionMap, std::string> split_into_sections(std::istream &input);
-std::expected<Molecule, std::string> parse_geometry(const std::vector<std::string> &lines);
-std::expected<Calculator, std::string> parse_calculator(const std::vector<std::string> &lines);
-std::expected<void, std::string> read_input(std::istream &input, Calculator &calculator, Molecule &molecule);
+std::expected<SectionMap, std::string> split_into_sections(std::string_view text);
+std::expected<Molecule, std::string> parse_geometry(std::span<const std::string_view> lines);
+std::expected<Molecule, std::string> parse_geometry_frames(std::span<const std::string_view> lines);
+std::expected<Calculator, std::string> parse_calculator(std::span<const std::string_view> lines);
+
+// Multi-frame XYZ text / file; all frames must hold the same atoms
+std::expected<Molecule, std::string> parse_xyz_frames(std::string_view text);
+std::expected<Molecule, std::string> read_xyz_file(const std::string &filename);
+
+// Parse input text; relative file names in it are taken from `directory`
+std::expected<void, std::string> read_input(std::string_view text, const std::string &directory, Calculator &calculator, Molecule &molecule);
+
+// Map an input file and parse it in place
+std::expected<void, std::string> read_input_file(const std::string &filename, Calculator &calculator, Molecule &molecule);
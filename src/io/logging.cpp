@@ -1,23 +1,400 @@
 #include "logging.h"
+#include "json.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <format>
-#include <iomanip>
+#include <fstream>
+#include <iterator>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace
 {
-    // set a mutex to enable OpenMPI writes
-    std::mutex log_mutex;
+    using Clock = std::chrono::steady_clock;
 
-    constexpr const char *info_prefix = "[Planck][INF] => ";
-    constexpr const char *error_prefix = "[Planck][ERR] => ";
+    constexpr const char *level_prefix[] = {"[Planck][TRC] => ", "[Planck][DBG] => ", "[Planck][INF] => ", "[Planck][ERR] => "};
+    constexpr const char *level_name[] = {"trace", "debug", "info", "error"};
+
+    // One slot of a ring; label and message share the text, and a message
+    // longer than one slot continues in the following slots
+    struct LogRecord
+    {
+        std::int64_t time_ns;
+        std::uint32_t thread;
+        std::uint8_t level;
+        bool continued; // more text follows in the next slot
+        bool quiet;     // queued under a QuietConsole, kept off the console
+        std::uint16_t label_size;
+        std::uint16_t text_size;
+        char text[236];
+    };
+
+    static_assert(sizeof(LogRecord) == 256);
+
+    constexpr std::size_t ring_slots = 256;
+
+    // Set by QuietConsole on the calling thread
+    thread_local bool console_quiet = false;
+
+    // Single-producer single-consumer ring owned by one thread; the writer is
+    // the only consumer
+    struct LogRing
+    {
+        std::array<LogRecord, ring_slots> slots;
+        alignas(64) std::atomic<std::uint64_t> head{0}; // next slot to fill
+        alignas(64) std::atomic<std::uint64_t> tail{0}; // next slot to drain
+        std::uint32_t thread = 0;
+    };
+
+    // A message as the writer reassembles it
+    struct LogEntry
+    {
+        std::int64_t time_ns;
+        std::uint32_t thread;
+        LogLevel level;
+        bool quiet;
+        std::string label;
+        std::string message;
+    };
+
+    class Logger
+    {
+    public:
+        Logger() : start_(Clock::now()), writer_([this]
+                                                 { run(); }) {}
+
+        ~Logger()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_one();
+            writer_.join();
+        }
+
+        static Logger &instance()
+        {
+            static Logger logger;
+            return logger;
+        }
+
+        void push(LogLevel level, std::string_view label, std::string_view message);
+        void flush();
+
+        std::atomic<int> min_level{static_cast<int>(LogLevel::Info)};
+        std::atomic<bool> console_info{true};
+        std::atomic<bool> json_open{false};
+
+        std::expected<void, std::string> open_json(const std::string &filename);
+
+    private:
+        LogRing &ring();
+        void run();
+        void drain();
+        void write(const std::vector<LogEntry> &entries);
+
+        Clock::time_point start_;
+
+        // Rings of every thread that ever logged; never freed before the logger
+        std::mutex rings_mutex_;
+        std::vector<std::unique_ptr<LogRing>> rings_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable drained_;
+        bool stop_ = false;
+        std::uint64_t flush_requested_ = 0;
+        std::uint64_t flush_completed_ = 0;
+        std::atomic<bool> backlog_{false}; // some ring is more than half full
+
+        std::unique_ptr<std::ofstream> pending_json_; // handed to the writer under mutex_
+        std::ofstream json_;                          // writer thread only
+
+        std::thread writer_;
+    };
+
+    LogRing &Logger::ring()
+    {
+        thread_local LogRing *local = nullptr;
+        if (!local)
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            rings_.push_back(std::make_unique<LogRing>());
+            local = rings_.back().get();
+            local->thread = static_cast<std::uint32_t>(rings_.size() - 1);
+        }
+        return *local;
+    }
+
+    void Logger::push(LogLevel level, std::string_view label, std::string_view message)
+    {
+        LogRing &r = ring();
+        constexpr std::size_t capacity = sizeof(LogRecord::text);
+
+        // Label in the first slot, message after it, spilling into later slots;
+        // whatever does not fit half the ring is cut
+        label = label.substr(0, std::min<std::size_t>(label.size(), capacity));
+        const std::size_t max_text = (ring_slots / 2) * capacity - label.size();
+        message = message.substr(0, std::min(message.size(), max_text));
+
+        const std::size_t total = label.size() + message.size();
+        const std::size_t nslots = std::max<std::size_t>(1, (total + capacity - 1) / capacity);
+
+        const std::uint64_t head = r.head.load(std::memory_order_relaxed);
+        std::uint64_t used = head - r.tail.load(std::memory_order_acquire);
+        while (used + nslots > ring_slots)
+        {
+            // Full: let the writer catch up
+            backlog_.store(true, std::memory_order_relaxed);
+            wake_.notify_one();
+            std::this_thread::yield();
+            used = head - r.tail.load(std::memory_order_acquire);
+        }
+
+        const std::int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_).count();
+
+        std::size_t label_left = label.size();
+        std::size_t message_pos = 0;
+        for (std::size_t s = 0; s < nslots; ++s)
+        {
+            LogRecord &record = r.slots[(head + s) % ring_slots];
+            record.time_ns = now;
+            record.thread = r.thread;
+            record.level = static_cast<std::uint8_t>(level);
+            record.continued = (s + 1 < nslots);
+            record.quiet = console_quiet;
+            record.label_size = static_cast<std::uint16_t>(label_left);
+
+            std::memcpy(record.text, label.data(), label_left);
+            const std::size_t n = std::min(capacity - label_left, message.size() - message_pos);
+            std::memcpy(record.text + label_left, message.data() + message_pos, n);
+            record.text_size = static_cast<std::uint16_t>(label_left + n);
+
+            message_pos += n;
+            label_left = 0;
+        }
+
+        r.head.store(head + nslots, std::memory_order_release);
+
+        // Wake the writer early rather than wait for its next round
+        if (used + nslots > ring_slots / 2 && !backlog_.exchange(true, std::memory_order_relaxed))
+            wake_.notify_one();
+    }
+
+    void Logger::flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const std::uint64_t ticket = ++flush_requested_;
+        wake_.notify_one();
+        drained_.wait(lock, [&]
+                      { return flush_completed_ >= ticket; });
+    }
+
+    std::expected<void, std::string> Logger::open_json(const std::string &filename)
+    {
+        std::ofstream file(filename, std::ios::trunc);
+        if (!file)
+            return std::unexpected("Cannot open log file " + filename);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_json_ = std::make_unique<std::ofstream>(std::move(file));
+        }
+        json_open.store(true, std::memory_order_relaxed);
+
+        // The writer takes the file over on its next pass
+        flush();
+        return {};
+    }
+
+    void Logger::run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            // Messages are picked up every few milliseconds, or at once when
+            // a thread flushes or fills half of its ring
+            wake_.wait_for(lock, std::chrono::milliseconds(5), [&]
+                           { return stop_ || flush_requested_ != flush_completed_ || backlog_.load(std::memory_order_relaxed); });
+
+            backlog_.store(false, std::memory_order_relaxed);
+
+            const bool stopping = stop_;
+            const std::uint64_t ticket = flush_requested_;
+
+            if (pending_json_)
+            {
+                json_ = std::move(*pending_json_);
+                pending_json_.reset();
+            }
+
+            lock.unlock();
+            drain();
+            lock.lock();
+
+            flush_completed_ = ticket;
+            drained_.notify_all();
+
+            if (stopping)
+                break;
+        }
+    }
+
+    void Logger::drain()
+    {
+        std::vector<LogRing *> rings;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            for (const auto &r : rings_)
+                rings.push_back(r.get());
+        }
+
+        std::vector<LogEntry> entries;
+        for (LogRing *r : rings)
+        {
+            std::uint64_t tail = r->tail.load(std::memory_order_relaxed);
+            const std::uint64_t head = r->head.load(std::memory_order_acquire);
+
+            while (tail < head)
+            {
+                const LogRecord &first = r->slots[tail % ring_slots];
+                LogEntry entry{first.time_ns, first.thread, static_cast<LogLevel>(first.level), first.quiet,
+                               std::string(first.text, first.label_size),
+                               std::string(first.text + first.label_size, first.text_size - first.label_size)};
+
+                bool continued = first.continued;
+                ++tail;
+                while (continued)
+                {
+                    const LogRecord &next = r->slots[tail % ring_slots];
+                    entry.message.append(next.text, next.text_size);
+                    continued = next.continued;
+                    ++tail;
+                }
+
+                entries.push_back(std::move(entry));
+            }
+
+            r->tail.store(tail, std::memory_order_release);
+        }
+
+        if (entries.empty())
+            return;
+
+        // Interleave the threads in time; each thread's own order is kept
+        std::stable_sort(entries.begin(), entries.end(), [](const LogEntry &a, const LogEntry &b)
+                         { return a.time_ns < b.time_ns; });
+
+        write(entries);
+    }
+
+    void Logger::write(const std::vector<LogEntry> &entries)
+    {
+        // One write per pass and sink; errors go to stderr in sequence
+        std::string console, json;
+        const int min = min_level.load(std::memory_order_relaxed);
+        const bool info = console_info.load(std::memory_order_relaxed);
+
+        for (const LogEntry &entry : entries)
+        {
+            const int level = static_cast<int>(entry.level);
+            if (level < min)
+                continue;
+
+            if (entry.level == LogLevel::Error)
+            {
+                std::cout << console << std::flush;
+                console.clear();
+                std::cerr << std::format("{:<20}{:<35}{}\n", level_prefix[level], entry.label, entry.message);
+            }
+            else if (info && !entry.quiet)
+            {
+                std::format_to(std::back_inserter(console), "{:<20}{:<35}{}\n", level_prefix[level], entry.label, entry.message);
+            }
+
+            if (json_.is_open())
+            {
+                std::format_to(std::back_inserter(json), "{{\"time\":{:.6f},\"thread\":{},\"level\":\"{}\",\"label\":\"{}\",\"message\":\"{}\"}}\n",
+                               static_cast<double>(entry.time_ns) * 1e-9, entry.thread, level_name[level],
+                               json_escape(entry.label), json_escape(entry.message));
+            }
+        }
+
+        std::cout << console << std::flush;
+        if (json_.is_open())
+            json_ << json << std::flush;
+    }
+}
+
+void logging(LogLevel level, std::string_view label, std::string_view message)
+{
+    Logger &logger = Logger::instance();
+
+    // Messages no sink would write never reach the ring
+    if (static_cast<int>(level) < logger.min_level.load(std::memory_order_relaxed))
+        return;
+    const bool console = logger.console_info.load(std::memory_order_relaxed) && !console_quiet;
+    if (level != LogLevel::Error && !console && !logger.json_open.load(std::memory_order_relaxed))
+        return;
+
+    logger.push(level, label, message);
+
+    if (level == LogLevel::Error)
+        logger.flush();
+}
+
+void set_logging_enabled(bool enabled)
+{
+    Logger::instance().console_info.store(enabled, std::memory_order_relaxed);
+}
+
+QuietConsole::QuietConsole(bool quiet) noexcept : previous_(console_quiet)
+{
+    console_quiet = previous_ || quiet;
+}
+
+QuietConsole::~QuietConsole()
+{
+    console_quiet = previous_;
+}
+
+bool QuietConsole::active() noexcept
+{
+    return console_quiet;
+}
+
+void set_log_level(LogLevel level)
+{
+    Logger::instance().min_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+std::expected<LogLevel, std::string> log_level_from_string(std::string_view name)
+{
+    for (int level = 0; level <= static_cast<int>(LogLevel::Error); ++level)
+    {
+        if (name == level_name[level])
+            return static_cast<LogLevel>(level);
+    }
+
+    return std::unexpected("Unknown log level " + std::string(name));
+}
+
+std::expected<void, std::string> open_json_log(const std::string &filename)
+{
+    return Logger::instance().open_json(filename);
 }
 
-void logging(LogLevel level, const std::string &label, const std::string &message)
+void flush_logs()
 {
-    std::lock_guard<std::mutex> lock(log_mutex);
-    const char *prefix = (level == LogLevel::Info) ? info_prefix : error_prefix;
-    std::ostream &out_stream = (level == LogLevel::Info) ? std::cout : std::cerr;
-    out_stream << std::setw(20) << std::left << prefix << std::setw(35) << std::left << label << message << '\n';
+    Logger::instance().flush();
 }
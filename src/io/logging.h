@@ -1,12 +1,84 @@
 #pragma once
 
+#include <expected>
 #include <string>
+#include <string_view>
 
 enum class LogLevel
 {
+    Trace,
+    Debug,
     Info,
     Error
 };
 
-/// Thread-safe, formatted logging
-void logging(LogLevel level, const std::string &label, const std::string &message);
+/// Lowest level compiled into the program (0 = Trace, 1 = Debug, 2 = Info);
+/// release builds drop debug and trace messages entirely
+#ifndef PLANCK_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define PLANCK_LOG_MIN_LEVEL 2
+#else
+#define PLANCK_LOG_MIN_LEVEL 0
+#endif
+#endif
+
+constexpr bool log_level_compiled(LogLevel level) noexcept
+{
+    return static_cast<int>(level) >= PLANCK_LOG_MIN_LEVEL;
+}
+
+/// Queue a message on the calling thread's ring buffer; a background thread
+/// formats and writes it. Lock-free and allocation-free on the calling thread,
+/// so it is safe inside parallel loops. Errors are written before returning.
+void logging(LogLevel level, std::string_view label, std::string_view message);
+
+/// Debug and trace messages; when compiled out the arguments are not evaluated
+#define PLANCK_LOG_DEBUG(label, message)                          \
+    do                                                            \
+    {                                                             \
+        if constexpr (log_level_compiled(LogLevel::Debug))        \
+            logging(LogLevel::Debug, (label), (message));         \
+    } while (0)
+
+#define PLANCK_LOG_TRACE(label, message)                          \
+    do                                                            \
+    {                                                             \
+        if constexpr (log_level_compiled(LogLevel::Trace))        \
+            logging(LogLevel::Trace, (label), (message));         \
+    } while (0)
+
+/// Enable or suppress informational messages on the console (errors are
+/// always written); used to keep all but one MPI rank quiet
+void set_logging_enabled(bool enabled);
+
+/// While alive, informational messages queued by the calling thread stay off
+/// the console; errors and the JSON log are unaffected, and so is every other
+/// thread. TaskPool workers take over the setting of the thread that starts
+/// a run. Scopes nest.
+class QuietConsole
+{
+public:
+    explicit QuietConsole(bool quiet = true) noexcept;
+    ~QuietConsole();
+
+    QuietConsole(const QuietConsole &) = delete;
+    QuietConsole &operator=(const QuietConsole &) = delete;
+
+    /// Whether the calling thread is inside a quiet scope
+    static bool active() noexcept;
+
+private:
+    bool previous_;
+};
+
+/// Lowest level written at run time (default Info)
+void set_log_level(LogLevel level);
+
+/// "trace", "debug", "info" or "error"
+std::expected<LogLevel, std::string> log_level_from_string(std::string_view name);
+
+/// Also write every message as one JSON object per line to `filename`
+std::expected<void, std::string> open_json_log(const std::string &filename);
+
+/// Block until every message queued so far has been written
+void flush_logs();
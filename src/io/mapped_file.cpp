@@ -0,0 +1,89 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+std::expected<MappedFile, std::string> MappedFile::open(const std::string &filename)
+{
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return std::unexpected("Cannot open " + filename);
+
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        ::close(fd);
+        return std::unexpected(filename + " is not a regular file");
+    }
+
+    MappedFile file;
+    file.size_ = static_cast<std::size_t>(info.st_size);
+
+    // mmap rejects a zero length; an empty file maps to an empty view
+    if (file.size_ > 0)
+    {
+        void *map = mmap(nullptr, file.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            ::close(fd);
+            return std::unexpected("Cannot map " + filename);
+        }
+
+        // Parsers read front to back exactly once
+        madvise(map, file.size_, MADV_SEQUENTIAL);
+        file.map_ = map;
+    }
+
+    ::close(fd);
+    return file;
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        map_ = std::exchange(other.map_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+void MappedFile::unmap() noexcept
+{
+    if (map_)
+        munmap(map_, size_);
+    map_ = nullptr;
+    size_ = 0;
+}
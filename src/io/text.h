@@ -0,0 +1,102 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Allocation-free helpers for scanning text held in memory (input files,
+// basis sets); every result is a view into the scanned buffer
+namespace Text
+{
+    // Successive lines of a text buffer, without copies
+    class LineCursor
+    {
+    public:
+        explicit LineCursor(std::string_view text) : text_(text) {}
+
+        bool next(std::string_view &line) noexcept
+        {
+            if (pos_ >= text_.size())
+                return false;
+
+            const auto end = text_.find('\n', pos_);
+            const std::size_t stop = (end == std::string_view::npos) ? text_.size() : end;
+
+            line = text_.substr(pos_, stop - pos_);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+
+            pos_ = stop + 1;
+            return true;
+        }
+
+    private:
+        std::string_view text_;
+        std::size_t pos_ = 0;
+    };
+
+    inline bool is_blank(char c) noexcept
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    // Split off the next whitespace-separated token of `line`
+    inline std::string_view next_token(std::string_view &line) noexcept
+    {
+        std::size_t first = 0;
+        while (first < line.size() && is_blank(line[first]))
+            ++first;
+
+        std::size_t last = first;
+        while (last < line.size() && !is_blank(line[last]))
+            ++last;
+
+        const std::string_view token = line.substr(first, last - first);
+        line.remove_prefix(last);
+        return token;
+    }
+
+    // Number of tokens in a line, without parsing them
+    inline std::size_t count_tokens(std::string_view line) noexcept
+    {
+        std::size_t count = 0;
+        while (!next_token(line).empty())
+            ++count;
+        return count;
+    }
+
+    // Parse the whole token as a number
+    template <typename T>
+    bool parse_number(std::string_view token, T &value) noexcept
+    {
+        const auto [ptr, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+        return ec == std::errc() && ptr == token.data() + token.size();
+    }
+
+    inline std::string_view trim(std::string_view line) noexcept
+    {
+        while (!line.empty() && is_blank(line.front()))
+            line.remove_prefix(1);
+        while (!line.empty() && is_blank(line.back()))
+            line.remove_suffix(1);
+        return line;
+    }
+};
@@ -32,7 +32,7 @@ T dot_product(const std::array<T, N> &a, const std::array<T, N> &b)
     return result;
 }
 
-double double_factorial(int n)
+inline double double_factorial(int n)
 {
     // Base case when n < -1
     if (n < -1)
@@ -55,7 +55,7 @@ double double_factorial(int n)
     return result;
 }
 
-long double combination(int n, int r)
+inline long double combination(int n, int r)
 {
     if (r < 0 || r > n)
         throw std::runtime_error("Invalid r for combination");
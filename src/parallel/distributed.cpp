@@ -0,0 +1,172 @@
+#include "distributed.h"
+#include "io/logging.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+#include <limits>
+#include <numeric>
+
+#ifdef PLANCK_USE_MPI
+#include <mpi.h>
+#endif
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+MpiSession::MpiSession()
+{
+#ifdef PLANCK_USE_MPI
+    // Only the master thread of each rank talks to MPI, but the worker
+    // threads exist, which MPI_THREAD_SINGLE does not allow
+    int provided = 0;
+    MPI_Init_thread(nullptr, nullptr, MPI_THREAD_FUNNELED, &provided);
+
+    if (provided < MPI_THREAD_FUNNELED)
+    {
+        if (Distributed::rank() == 0)
+            logging(LogLevel::Error, "MPI Error :", "The MPI library does not support MPI_THREAD_FUNNELED");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+#endif
+}
+
+MpiSession::~MpiSession()
+{
+#ifdef PLANCK_USE_MPI
+    MPI_Finalize();
+#endif
+}
+
+DynamicCounter::DynamicCounter()
+{
+#ifdef PLANCK_USE_MPI
+    long *base = nullptr;
+    MPI_Win *window = new MPI_Win;
+
+    const MPI_Aint bytes = (Distributed::rank() == 0) ? sizeof(long) : 0;
+    MPI_Win_allocate(bytes, sizeof(long), MPI_INFO_NULL, MPI_COMM_WORLD, &base, window);
+    if (Distributed::rank() == 0)
+        *base = 0;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, *window);
+    window_ = window;
+#endif
+}
+
+DynamicCounter::~DynamicCounter()
+{
+#ifdef PLANCK_USE_MPI
+    MPI_Win *window = static_cast<MPI_Win *>(window_);
+    MPI_Win_unlock_all(*window);
+    MPI_Win_free(window);
+    delete window;
+#endif
+}
+
+std::size_t DynamicCounter::next(std::size_t count)
+{
+#ifdef PLANCK_USE_MPI
+    MPI_Win *window = static_cast<MPI_Win *>(window_);
+    const long increment = static_cast<long>(count);
+    long first = 0;
+
+    MPI_Fetch_and_op(&increment, &first, MPI_LONG, 0, 0, MPI_SUM, *window);
+    MPI_Win_flush(0, *window);
+    return static_cast<std::size_t>(first);
+#else
+    const std::size_t first = local_;
+    local_ += count;
+    return first;
+#endif
+}
+
+int Distributed::rank() noexcept
+{
+#ifdef PLANCK_USE_MPI
+    int rank = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return rank;
+#else
+    return 0;
+#endif
+}
+
+int Distributed::size() noexcept
+{
+#ifdef PLANCK_USE_MPI
+    int size = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    return size;
+#else
+    return 1;
+#endif
+}
+
+void Distributed::allreduce_sum(std::vector<double> &data)
+{
+#ifdef PLANCK_USE_MPI
+    if (size() == 1)
+        return;
+
+    // MPI counts are int; larger vectors are reduced in pieces
+    constexpr std::size_t max_count = static_cast<std::size_t>(std::numeric_limits<int>::max());
+    for (std::size_t offset = 0; offset < data.size(); offset += max_count)
+    {
+        const int count = static_cast<int>(std::min(max_count, data.size() - offset));
+        MPI_Allreduce(MPI_IN_PLACE, data.data() + offset, count, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    }
+#else
+    (void)data;
+#endif
+}
+
+void Distributed::report_load_balance(const std::string &phase, const RankLoad &load)
+{
+    const int nranks = size();
+    std::vector<double> local = {static_cast<double>(load.tasks), load.cost, load.busy_seconds};
+    std::vector<double> all(3 * static_cast<std::size_t>(nranks), 0.0);
+
+#ifdef PLANCK_USE_MPI
+    MPI_Gather(local.data(), 3, MPI_DOUBLE, all.data(), 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#else
+    all = local;
+#endif
+
+    if (rank() != 0 || nranks == 1)
+        return;
+
+    double total_cost = 0.0, max_busy = 0.0, sum_busy = 0.0;
+    for (int r = 0; r < nranks; ++r)
+    {
+        total_cost += all[3 * r + 1];
+        max_busy = std::max(max_busy, all[3 * r + 2]);
+        sum_busy += all[3 * r + 2];
+    }
+
+    logging(LogLevel::Info, phase + " Load Balance :", std::format("{} ranks", nranks));
+    for (int r = 0; r < nranks; ++r)
+    {
+        const double share = (total_cost > 0.0) ? 100.0 * all[3 * r + 1] / total_cost : 0.0;
+        logging(LogLevel::Info, "", std::format("rank {:>4} : {:>8} tasks {:>7.2f} % of cost {:>10.4f} s", r, static_cast<std::size_t>(all[3 * r]), share, all[3 * r + 2]));
+    }
+
+    // max / mean busy time; 1.0 is perfect balance
+    const double mean_busy = sum_busy / nranks;
+    logging(LogLevel::Info, "", std::format("imbalance (max/mean) : {:.3f}", (mean_busy > 0.0) ? max_busy / mean_busy : 1.0));
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "parallel/task_pool.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Work done by one rank in one distributed phase
+struct RankLoad
+{
+    std::size_t tasks = 0;
+    double cost = 0.0;         // summed cost estimate
+    double busy_seconds = 0.0; // wall time inside task runs, without waiting on MPI
+};
+
+// MPI initialization and finalization for the lifetime of main
+// (no-op unless built with ENABLE_MPI)
+class MpiSession
+{
+public:
+    MpiSession();
+    ~MpiSession();
+
+    MpiSession(const MpiSession &) = delete;
+    MpiSession &operator=(const MpiSession &) = delete;
+};
+
+// Shared counter handing out chunk indices to ranks (MPI one-sided
+// fetch-and-add on rank 0). Construction and destruction are collective.
+class DynamicCounter
+{
+public:
+    DynamicCounter();
+    ~DynamicCounter();
+
+    DynamicCounter(const DynamicCounter &) = delete;
+    DynamicCounter &operator=(const DynamicCounter &) = delete;
+
+    // Reserve `count` consecutive indices and return the first one
+    std::size_t next(std::size_t count);
+
+private:
+    void *window_ = nullptr;
+    std::size_t local_ = 0; // counter used without MPI
+};
+
+// Distribution of task batches over MPI ranks
+//
+// Every rank holds the full (replicated) input and the same task list. Tasks
+// are sorted by descending cost and either dealt round-robin to the ranks or
+// cut into chunks of about equal cost that ranks claim from a shared counter,
+// so ranks that finish early keep taking work. Inside a rank the tasks run
+// on the work-stealing TaskPool.
+// Results are combined afterwards with allreduce_sum. BatchDistribution::Local
+// runs every task on the calling rank and needs no reduction.
+namespace Distributed
+{
+    int rank() noexcept;
+    int size() noexcept;
+
+    // Element-wise sum of `data` over all ranks, result on every rank
+    void allreduce_sum(std::vector<double> &data);
+
+    // Gather each rank's load on rank 0 and log the per-rank balance there
+    void report_load_balance(const std::string &phase, const RankLoad &load);
+
+    // Chunks per rank for the dynamic schedule: enough for ranks that finish
+    // early to take over work, few enough that each chunk fills the pool
+    inline constexpr std::size_t chunks_per_rank = 4;
+
+    template <typename Body>
+    RankLoad run(std::vector<Task> tasks, BatchDistribution distribution, Body &&body)
+    {
+        std::stable_sort(tasks.begin(), tasks.end(), [](const Task &a, const Task &b)
+                         { return a.cost > b.cost; });
+
+        RankLoad load;
+        auto run_local = [&](std::vector<Task> local)
+        {
+            for (const Task &task : local)
+                load.cost += task.cost;
+            load.tasks += local.size();
+
+            const auto start = std::chrono::steady_clock::now();
+            TaskPool::run(std::move(local), body);
+
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            load.busy_seconds += elapsed.count();
+        };
+
+        const int nranks = size();
+        if (distribution == BatchDistribution::Local)
+        {
+            run_local(std::move(tasks));
+        }
+        else if (distribution == BatchDistribution::RoundRobin || nranks == 1)
+        {
+            std::vector<Task> local;
+            for (std::size_t i = static_cast<std::size_t>(rank()); i < tasks.size(); i += nranks)
+                local.push_back(tasks[i]);
+
+            run_local(std::move(local));
+        }
+        else
+        {
+            // Every rank cuts the same chunks: consecutive tasks, most expensive
+            // first, each holding a share of the cost and at least one task
+            // per local thread
+            double total_cost = 0.0;
+            for (const Task &task : tasks)
+                total_cost += task.cost;
+
+            const double chunk_cost = total_cost / static_cast<double>(chunks_per_rank * static_cast<std::size_t>(nranks));
+            const std::size_t min_tasks = static_cast<std::size_t>(TaskPool::max_threads());
+
+            std::vector<std::size_t> bounds = {0};
+            double cost = 0.0;
+            for (std::size_t i = 0; i < tasks.size(); ++i)
+            {
+                cost += tasks[i].cost;
+                if (cost >= chunk_cost && i + 1 - bounds.back() >= min_tasks)
+                {
+                    bounds.push_back(i + 1);
+                    cost = 0.0;
+                }
+            }
+            if (bounds.back() != tasks.size())
+                bounds.push_back(tasks.size());
+
+            // Freeing the counter is collective: a rank whose chunk throws keeps
+            // claiming (and skipping) chunks until the counter runs out, so
+            // the other ranks are not left waiting, and rethrows afterwards
+            std::exception_ptr failure;
+            {
+                DynamicCounter counter;
+                for (std::size_t chunk = counter.next(1); chunk + 1 < bounds.size(); chunk = counter.next(1))
+                {
+                    if (failure)
+                        continue;
+
+                    try
+                    {
+                        run_local(std::vector<Task>(tasks.begin() + bounds[chunk], tasks.begin() + bounds[chunk + 1]));
+                    }
+                    catch (...)
+                    {
+                        failure = std::current_exception();
+                    }
+                }
+            }
+
+            if (failure)
+                std::rethrow_exception(failure);
+        }
+
+        return load;
+    }
+};
@@ -0,0 +1,95 @@
+#include "numa.h"
+
+#include <atomic>
+
+#include <sys/mman.h>
+
+#ifdef PLANCK_HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+namespace
+{
+    std::atomic<NumaPolicy> current_policy{NumaPolicy::FirstTouch};
+
+    // Below this size the buffer fits in a few pages and placement is irrelevant
+    constexpr std::size_t mmap_threshold = std::size_t{1} << 20;
+}
+
+void Numa::set_policy(NumaPolicy policy) noexcept
+{
+    current_policy.store(policy, std::memory_order_relaxed);
+}
+
+NumaPolicy Numa::policy() noexcept
+{
+    return current_policy.load(std::memory_order_relaxed);
+}
+
+int Numa::nodes() noexcept
+{
+#ifdef PLANCK_HAVE_LIBNUMA
+    if (numa_available() >= 0)
+        return numa_num_configured_nodes();
+#endif
+    return 1;
+}
+
+std::string Numa::policy_name(NumaPolicy policy)
+{
+    switch (policy)
+    {
+    case NumaPolicy::Off:
+        return "off";
+    case NumaPolicy::FirstTouch:
+        return "first-touch";
+    case NumaPolicy::Interleave:
+        return "interleave";
+    }
+    return "unknown";
+}
+
+void *Numa::allocate(std::size_t bytes)
+{
+    if (bytes < mmap_threshold)
+        return ::operator new(bytes);
+
+    void *ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+        throw std::bad_alloc();
+
+#ifdef PLANCK_HAVE_LIBNUMA
+    if (policy() == NumaPolicy::Interleave && numa_available() >= 0)
+        numa_interleave_memory(ptr, bytes, numa_all_nodes_ptr);
+#endif
+
+    return ptr;
+}
+
+void Numa::deallocate(void *ptr, std::size_t bytes) noexcept
+{
+    if (!ptr)
+        return;
+
+    if (bytes < mmap_threshold)
+        ::operator delete(ptr);
+    else
+        munmap(ptr, bytes);
+}
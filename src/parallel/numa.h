@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "base/base.h"
+#include "parallel/task_pool.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Placement of large buffers on multi-socket machines (see NumaPolicy)
+//
+// Linux places a page on the NUMA node of the thread that first writes it.
+// Buffers initialized by a serial loop therefore all end up behind one
+// memory controller. Off keeps that serial initialization, FirstTouch
+// initializes large buffers on the task pool with the schedule of the loop
+// that later reads them, so their pages land on the nodes of the threads that
+// use them, and Interleave asks the kernel to round-robin pages over all
+// nodes (only in builds with libnuma; the input parser refuses it otherwise).
+namespace Numa
+{
+    void set_policy(NumaPolicy policy) noexcept;
+    NumaPolicy policy() noexcept;
+
+    // Number of NUMA nodes (1 without libnuma)
+    int nodes() noexcept;
+
+    std::string policy_name(NumaPolicy policy);
+
+    // Raw allocation: large requests get fresh, untouched pages from mmap
+    // (interleaved under NumaPolicy::Interleave), small ones use operator new
+    void *allocate(std::size_t bytes);
+    void deallocate(void *ptr, std::size_t bytes) noexcept;
+
+    // Run body(task) for every task, on TaskPool::run unless the policy is
+    // Off. Use it for the first write into a fresh numa_vector, with the task
+    // list of the loop that consumes the buffer: the pool deals equal lists
+    // to the same threads (see TaskPool::deal).
+    template <typename Body>
+    void first_touch(std::vector<Task> tasks, Body &&body)
+    {
+        if (policy() == NumaPolicy::Off)
+        {
+            for (const Task &task : tasks)
+                body(task);
+            return;
+        }
+
+        TaskPool::run(std::move(tasks), [&](const Task &task, int)
+                      { body(task); });
+    }
+}
+
+// Allocator for large buffers whose placement matters
+// Elements are default-initialized, so a numa_vector<double>(n) does not
+// touch its pages; the first write decides where they live.
+template <typename T>
+struct NumaAllocator
+{
+    using value_type = T;
+
+    NumaAllocator() noexcept = default;
+
+    template <typename U>
+    NumaAllocator(const NumaAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(Numa::allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T *ptr, std::size_t n) noexcept
+    {
+        Numa::deallocate(ptr, n * sizeof(T));
+    }
+
+    template <typename U>
+    void construct(U *ptr) noexcept(std::is_nothrow_default_constructible_v<U>)
+    {
+        ::new (static_cast<void *>(ptr)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U *ptr, Args &&...args)
+    {
+        ::new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const NumaAllocator<U> &) const noexcept { return true; }
+};
+
+template <typename T>
+using numa_vector = std::vector<T, NumaAllocator<T>>;
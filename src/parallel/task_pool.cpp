@@ -0,0 +1,90 @@
+#include "task_pool.h"
+
+#include <numeric>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+void WorkDeque::push_back(const Task &task)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(task);
+}
+
+std::optional<Task> WorkDeque::pop_front()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.empty())
+        return std::nullopt;
+
+    Task task = tasks_.front();
+    tasks_.pop_front();
+    return task;
+}
+
+std::optional<Task> WorkDeque::steal_back()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.empty())
+        return std::nullopt;
+
+    Task task = tasks_.back();
+    tasks_.pop_back();
+    return task;
+}
+
+std::vector<std::vector<std::size_t>> TaskPool::deal(const std::vector<Task> &tasks)
+{
+    // Descending cost, dealt round-robin
+    std::vector<std::size_t> order(tasks.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+                     { return tasks[a].cost > tasks[b].cost; });
+
+    const int nthreads = std::max(1, std::min<int>(max_threads(), static_cast<int>(tasks.size())));
+
+    std::vector<std::vector<std::size_t>> dealt(nthreads);
+    for (std::size_t i = 0; i < order.size(); ++i)
+        dealt[i % nthreads].push_back(order[i]);
+
+    return dealt;
+}
+
+int TaskPool::max_threads() noexcept
+{
+#ifdef _OPENMP
+    // A run started inside a region that cannot nest gets a single thread
+    if (omp_get_active_level() >= omp_get_max_active_levels())
+        return 1;
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+int TaskPool::thread_id() noexcept
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
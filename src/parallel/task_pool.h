@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <format>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "io/logging.h"
+#include "profile/timers.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Unit of work handed to the task pool
+struct Task
+{
+    std::size_t index = 0; // caller-defined payload (batch number, job number, ...)
+    double cost = 0.0;     // estimated cost, only used for ordering
+};
+
+// Per-thread execution statistics of one TaskPool::run
+struct TaskPoolStats
+{
+    std::vector<std::size_t> executed; // tasks run by each thread
+    std::vector<std::size_t> stolen;   // of which taken from another thread's deque
+    std::vector<double> cost;          // summed cost estimate of the tasks run
+};
+
+// Mutex-protected double-ended queue owned by one worker thread.
+// The owner takes work from the front, thieves from the back.
+class alignas(64) WorkDeque
+{
+public:
+    void push_back(const Task &task);
+    std::optional<Task> pop_front();
+    std::optional<Task> steal_back();
+
+private:
+    std::mutex mutex_;
+    std::deque<Task> tasks_;
+};
+
+// Work-stealing scheduler for tasks of very uneven cost
+//
+// Tasks are sorted by descending cost and dealt round-robin into one deque
+// per thread, so every thread starts on its share of the expensive work.
+// A thread that runs dry steals the cheapest remaining task of another
+// thread, which keeps all threads busy until the very end of the phase.
+// Threads come from the OpenMP runtime; without OpenMP everything runs on
+// the calling thread.
+namespace TaskPool
+{
+    // Number of worker threads a run will use
+    int max_threads() noexcept;
+
+    // Index of the calling worker inside a run (0 outside of one)
+    int thread_id() noexcept;
+
+    // How run() deals `tasks` to its threads: for every thread, the positions
+    // in `tasks` it starts with, in the order it runs them. Apart from
+    // stealing at the end of a run, this is where every task executes.
+    std::vector<std::vector<std::size_t>> deal(const std::vector<Task> &tasks);
+
+    // body(const Task &, int thread) is called exactly once per task.
+    // The first exception thrown by a task is rethrown once all threads are done.
+    template <typename Body>
+    TaskPoolStats run(std::vector<Task> tasks, Body &&body)
+    {
+        const auto dealt = deal(tasks);
+        const int nthreads = static_cast<int>(dealt.size());
+
+        std::vector<WorkDeque> deques(nthreads);
+        for (int t = 0; t < nthreads; ++t)
+            for (std::size_t i : dealt[t])
+                deques[t].push_back(tasks[i]);
+
+        TaskPoolStats stats;
+        stats.executed.assign(nthreads, 0);
+        stats.stolen.assign(nthreads, 0);
+        stats.cost.assign(nthreads, 0.0);
+
+        std::exception_ptr failure;
+        std::mutex failure_mutex;
+
+        // Timers of the workers nest under the phase that started the run
+        const Profile::TimerContext timer_context = Profile::current_context();
+        const bool tracing = Profile::tracing_enabled();
+        const bool quiet = QuietConsole::active();
+
+#pragma omp parallel num_threads(nthreads)
+        {
+            const int tid = thread_id();
+
+            Profile::ContextScope timer_scope(timer_context);
+            const QuietConsole quiet_scope(quiet);
+            Profile::ScopedTimer busy_timer("Tasks");
+
+            while (true)
+            {
+                std::optional<Task> task = deques[tid].pop_front();
+                bool stolen = false;
+
+                // Own deque is empty: scan the others, starting with the next thread
+                for (int v = 1; !task && v < nthreads; ++v)
+                {
+                    task = deques[(tid + v) % nthreads].steal_back();
+                    if (task)
+                    {
+                        ++stats.stolen[tid];
+                        stolen = true;
+                    }
+                }
+
+                // No work left anywhere; tasks are never added during a run
+                if (!task)
+                    break;
+
+                const auto begin = tracing ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+                try
+                {
+                    body(*task, tid);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(failure_mutex);
+                    if (!failure)
+                        failure = std::current_exception();
+                }
+
+                if (tracing)
+                    Profile::trace_span("Task", begin, std::chrono::steady_clock::now(),
+                                        std::format("{{\"index\":{},\"cost\":{:.6g},\"stolen\":{}}}", task->index, task->cost, stolen));
+
+                ++stats.executed[tid];
+                stats.cost[tid] += task->cost;
+            }
+        }
+
+        if (failure)
+            std::rethrow_exception(failure);
+
+        return stats;
+    }
+}
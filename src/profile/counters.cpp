@@ -0,0 +1,192 @@
+#include "counters.h"
+#include "io/logging.h"
+
+#include <array>
+#include <format>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+namespace
+{
+    using Profile::IntegralKind;
+
+    constexpr std::size_t nkinds = 2;
+    constexpr std::size_t nL = MAX_SHELL_L + 1;
+    constexpr std::size_t nclasses = nL * nL * nL * nL;
+
+    constexpr const char *kind_name[nkinds] = {"overlap", "repulsion"};
+    constexpr const char *shell_letter = "spdfgh";
+    static_assert(MAX_SHELL_L < 6, "shell_letter needs a letter for every L");
+
+    struct ClassCounts
+    {
+        std::uint64_t screened = 0;
+        std::uint64_t computed = 0;
+        std::uint64_t primitives = 0;
+        double flops = 0.0;
+    };
+
+    // Counts of one thread, indexed by kind and class
+    struct alignas(64) CounterTable
+    {
+        std::array<ClassCounts, nkinds * nclasses> counts{};
+    };
+
+    // Tables of every thread that ever counted
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<CounterTable>> registry;
+
+    CounterTable &local_table()
+    {
+        thread_local CounterTable *table = nullptr;
+        if (!table)
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            registry.push_back(std::make_unique<CounterTable>());
+            table = registry.back().get();
+        }
+        return *table;
+    }
+
+    bool valid(int L) noexcept
+    {
+        return L >= 0 && L <= MAX_SHELL_L;
+    }
+
+    // Slot of a class, or nullptr if an angular momentum is out of range
+    ClassCounts *slot(IntegralKind kind, int La, int Lb, int Lc, int Ld) noexcept
+    {
+        if (!valid(La) || !valid(Lb) || !valid(Lc) || !valid(Ld))
+            return nullptr;
+
+        const std::size_t index = ((static_cast<std::size_t>(La) * nL + Lb) * nL + Lc) * nL + Ld;
+        return &local_table().counts[static_cast<std::size_t>(kind) * nclasses + index];
+    }
+
+    // "(p|d)" for pairs, "(sp|dd)" for quartets
+    std::string class_label(std::size_t kind, std::size_t index)
+    {
+        const std::size_t Ld = index % nL;
+        const std::size_t Lc = (index / nL) % nL;
+        const std::size_t Lb = (index / (nL * nL)) % nL;
+        const std::size_t La = index / (nL * nL * nL);
+
+        if (static_cast<IntegralKind>(kind) == IntegralKind::Overlap)
+            return std::format("({}|{})", shell_letter[La], shell_letter[Lb]);
+
+        return std::format("({}{}|{}{})", shell_letter[La], shell_letter[Lb], shell_letter[Lc], shell_letter[Ld]);
+    }
+
+    // Sum of all threads
+    std::vector<ClassCounts> merged()
+    {
+        std::vector<ClassCounts> total(nkinds * nclasses);
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (const auto &table : registry)
+        {
+            for (std::size_t i = 0; i < total.size(); ++i)
+            {
+                const ClassCounts &c = table->counts[i];
+                total[i].screened += c.screened;
+                total[i].computed += c.computed;
+                total[i].primitives += c.primitives;
+                total[i].flops += c.flops;
+            }
+        }
+
+        return total;
+    }
+
+    bool seen(const ClassCounts &c) noexcept
+    {
+        return c.screened > 0 || c.computed > 0;
+    }
+}
+
+void Profile::count_computed(IntegralKind kind, int La, int Lb, int Lc, int Ld, std::uint64_t primitives, double flops) noexcept
+{
+    if (ClassCounts *c = slot(kind, La, Lb, Lc, Ld))
+    {
+        ++c->computed;
+        c->primitives += primitives;
+        c->flops += flops;
+    }
+}
+
+void Profile::count_screened(IntegralKind kind, int La, int Lb, int Lc, int Ld, std::uint64_t blocks) noexcept
+{
+    if (ClassCounts *c = slot(kind, La, Lb, Lc, Ld))
+        c->screened += blocks;
+}
+
+std::string Profile::counter_report_json()
+{
+    const auto total = merged();
+
+    std::string out = "[";
+    bool first = true;
+    for (std::size_t i = 0; i < total.size(); ++i)
+    {
+        const ClassCounts &c = total[i];
+        if (!seen(c))
+            continue;
+
+        std::format_to(std::back_inserter(out), "{}\n  {{\"kind\":\"{}\",\"class\":\"{}\",\"screened\":{},\"computed\":{},\"primitives\":{},\"flops\":{:.6e}}}",
+                       first ? "" : ",", kind_name[i / nclasses], class_label(i / nclasses, i % nclasses),
+                       c.screened, c.computed, c.primitives, c.flops);
+        first = false;
+    }
+
+    out += first ? "]" : "\n]";
+    return out;
+}
+
+void Profile::log_counter_summary()
+{
+    const auto total = merged();
+
+    for (std::size_t kind = 0; kind < nkinds; ++kind)
+    {
+        ClassCounts sum;
+        for (std::size_t index = 0; index < nclasses; ++index)
+        {
+            const ClassCounts &c = total[kind * nclasses + index];
+            if (!seen(c))
+                continue;
+
+            logging(LogLevel::Info, "Integral Counts :",
+                    std::format("{:<10}{:<9}computed {:>10}  screened {:>10}  primitives {:>12}  flops {:.3e}",
+                                kind_name[kind], class_label(kind, index), c.computed, c.screened, c.primitives, c.flops));
+
+            sum.screened += c.screened;
+            sum.computed += c.computed;
+            sum.primitives += c.primitives;
+            sum.flops += c.flops;
+        }
+
+        if (seen(sum))
+            logging(LogLevel::Info, "Integral Counts :",
+                    std::format("{:<10}{:<9}computed {:>10}  screened {:>10}  primitives {:>12}  flops {:.3e}",
+                                kind_name[kind], "total", sum.computed, sum.screened, sum.primitives, sum.flops));
+    }
+}
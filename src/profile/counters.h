@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "basis/basis.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Integral workload counters
+//
+// For every class of shell blocks (the angular momenta La Lb of a pair, or
+// La Lb Lc Ld of a quartet) the integral kernels record how many blocks were
+// screened out and computed, how many primitive combinations the computed
+// ones contained, and an estimate of their floating-point operations. Each
+// thread counts into its own table, so counting takes no lock and shares no
+// cache line; the tables are summed when the report is built.
+//
+// The counters are compiled in only with PLANCK_ENABLE_COUNTERS (CMake option
+// of the same name). Without it the PLANCK_COUNT_* macros expand to nothing
+// and their arguments, FLOP estimates included, are never evaluated.
+namespace Profile
+{
+    enum class IntegralKind
+    {
+        Overlap,    // one-electron pairs (a|b)
+        Repulsion   // two-electron quartets (ab|cd)
+    };
+
+    constexpr bool counters_enabled() noexcept
+    {
+#ifdef PLANCK_ENABLE_COUNTERS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Pair classes pass Lc = Ld = 0
+    void count_computed(IntegralKind kind, int La, int Lb, int Lc, int Ld, std::uint64_t primitives, double flops) noexcept;
+    void count_screened(IntegralKind kind, int La, int Lb, int Lc, int Ld, std::uint64_t blocks = 1) noexcept;
+
+    // Counts of all threads as a JSON array, one object per class that was
+    // seen; no kernel may be counting while it is built
+    std::string counter_report_json();
+
+    // One log line per class and a total per kind
+    void log_counter_summary();
+};
+
+#ifdef PLANCK_ENABLE_COUNTERS
+#define PLANCK_COUNT_COMPUTED(kind, La, Lb, Lc, Ld, primitives, flops) \
+    ::Profile::count_computed((kind), (La), (Lb), (Lc), (Ld), (primitives), (flops))
+#define PLANCK_COUNT_SCREENED(kind, La, Lb, Lc, Ld) \
+    ::Profile::count_screened((kind), (La), (Lb), (Lc), (Ld))
+#else
+#define PLANCK_COUNT_COMPUTED(kind, La, Lb, Lc, Ld, primitives, flops) \
+    do                                                                  \
+    {                                                                   \
+    } while (0)
+#define PLANCK_COUNT_SCREENED(kind, La, Lb, Lc, Ld) \
+    do                                              \
+    {                                               \
+    } while (0)
+#endif
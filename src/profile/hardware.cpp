@@ -0,0 +1,250 @@
+#include "hardware.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+using Profile::HardwareCounts;
+using Profile::HardwareEvent;
+using Profile::HardwareEventCount;
+
+namespace
+{
+    constexpr const char *event_name[HardwareEventCount] = {"cycles", "instructions", "cache_misses", "vector_instructions"};
+
+    std::atomic<bool> enabled{false};
+    std::atomic<unsigned> available{0}; // bit per HardwareEvent
+
+#ifdef __linux__
+    struct EventConfig
+    {
+        std::uint32_t type;
+        std::uint64_t config;
+        bool valid;
+    };
+
+    bool intel_processor()
+    {
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(cpuinfo, line))
+        {
+            if (line.starts_with("vendor_id"))
+                return line.find("GenuineIntel") != std::string::npos;
+        }
+        return false;
+    }
+
+    EventConfig vector_event()
+    {
+        if (const char *raw = std::getenv("PLANCK_PERF_VECTOR_EVENT"))
+        {
+            char *end = nullptr;
+            const std::uint64_t config = std::strtoull(raw, &end, 16);
+            return {PERF_TYPE_RAW, config, end != raw && *end == '\0'};
+        }
+
+        // FP_ARITH_INST_RETIRED, umask 0xfc: 128-, 256- and 512-bit packed
+        // single and double precision
+        if (intel_processor())
+            return {PERF_TYPE_RAW, 0xfcc7, true};
+
+        return {PERF_TYPE_RAW, 0, false};
+    }
+
+    const std::array<EventConfig, HardwareEventCount> &event_configs()
+    {
+        static const std::array<EventConfig, HardwareEventCount> configs = {
+            EventConfig{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true},
+            EventConfig{PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, true},
+            EventConfig{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, true},
+            vector_event()};
+        return configs;
+    }
+
+    int open_event(const EventConfig &event, int group)
+    {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = event.type;
+        attr.config = event.config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.disabled = (group < 0);
+
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+    }
+
+    // Counters of one thread: one group, the first open event leads
+    struct ThreadCounters
+    {
+        int leader = -1;
+        std::array<int, HardwareEventCount> fds;
+        std::size_t nopen = 0;
+        bool failed = false;
+        int error = 0; // errno of the last event that did not open
+
+        ThreadCounters() { fds.fill(-1); }
+
+        ~ThreadCounters()
+        {
+            for (int fd : fds)
+            {
+                if (fd >= 0)
+                    close(fd);
+            }
+        }
+
+        // Open the events in `mask`; returns the mask of those that opened
+        unsigned open(unsigned mask)
+        {
+            unsigned opened = 0;
+            for (std::size_t e = 0; e < HardwareEventCount; ++e)
+            {
+                const EventConfig &event = event_configs()[e];
+                if (!(mask & (1u << e)) || !event.valid)
+                    continue;
+
+                const int fd = open_event(event, leader);
+                if (fd < 0)
+                {
+                    error = errno;
+                    continue;
+                }
+
+                fds[e] = fd;
+                if (leader < 0)
+                    leader = fd;
+                ++nopen;
+                opened |= 1u << e;
+            }
+
+            if (leader >= 0)
+            {
+                ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+                ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            }
+
+            return opened;
+        }
+
+        bool read(HardwareCounts &counts) noexcept
+        {
+            // { nr, values[nr] } in the order the events joined the group
+            std::array<std::uint64_t, HardwareEventCount + 1> buffer{};
+            const ssize_t size = static_cast<ssize_t>((nopen + 1) * sizeof(std::uint64_t));
+            if (leader < 0 || ::read(leader, buffer.data(), size) != size)
+                return false;
+
+            counts.fill(0);
+            std::size_t value = 1;
+            for (std::size_t e = 0; e < HardwareEventCount; ++e)
+            {
+                if (fds[e] >= 0)
+                    counts[e] = buffer[value++];
+            }
+            return true;
+        }
+    };
+
+    ThreadCounters &local_counters()
+    {
+        thread_local ThreadCounters counters;
+        thread_local bool opened = false;
+        if (!opened)
+        {
+            opened = true;
+
+            // Threads only count what the probing thread could count, so
+            // every phase reports the same events
+            const unsigned mask = available.load(std::memory_order_relaxed);
+            if (counters.open(mask) != mask)
+                counters.failed = true;
+        }
+        return counters;
+    }
+#endif
+}
+
+const char *Profile::hardware_event_name(HardwareEvent event) noexcept
+{
+    return event_name[event];
+}
+
+std::expected<std::string, std::string> Profile::enable_hardware_counters()
+{
+#ifdef __linux__
+    // Probe on a temporary group, so the calling thread opens its own later
+    unsigned mask = 0;
+    int error = 0;
+    {
+        ThreadCounters probe;
+        mask = probe.open((1u << HardwareEventCount) - 1);
+        error = probe.error;
+    }
+
+    if (!(mask & (1u << Cycles)) || !(mask & (1u << Instructions)))
+        return std::unexpected(std::string("cannot count cycles and instructions : ") + std::strerror(error));
+
+    std::string names;
+    for (std::size_t e = 0; e < HardwareEventCount; ++e)
+    {
+        if (mask & (1u << e))
+            names += (names.empty() ? "" : ", ") + std::string(event_name[e]);
+    }
+
+    available.store(mask, std::memory_order_relaxed);
+    enabled.store(true, std::memory_order_relaxed);
+    return names;
+#else
+    return std::unexpected("Hardware counters need Linux perf_event_open");
+#endif
+}
+
+bool Profile::hardware_counters_enabled() noexcept
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+bool Profile::hardware_event_available(HardwareEvent event) noexcept
+{
+    return available.load(std::memory_order_relaxed) & (1u << event);
+}
+
+bool Profile::read_hardware_counters(HardwareCounts &counts) noexcept
+{
+#ifdef __linux__
+    ThreadCounters &counters = local_counters();
+    return !counters.failed && counters.read(counts);
+#else
+    (void)counts;
+    return false;
+#endif
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <string>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Hardware performance counters (Linux perf_event_open)
+//
+// Every thread opens its own group of user-space counters the first time it
+// reads them; the phase timers read them when they start and stop, so each
+// phase of the timing report carries the cycles, instructions, cache misses
+// and vector instructions of the threads that ran it. Events the processor
+// or the kernel do not offer are left out; without any (other systems, a
+// virtual machine without a PMU, perf_event_paranoid > 2) nothing is counted
+// and the run goes on as usual.
+//
+// There is no portable event for vector instructions: on Intel processors
+// FP_ARITH_INST_RETIRED (all packed widths) is used, elsewhere the raw event
+// can be given in PLANCK_PERF_VECTOR_EVENT (hexadecimal perf raw config).
+namespace Profile
+{
+    enum HardwareEvent
+    {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        VectorInstructions,
+        HardwareEventCount
+    };
+
+    using HardwareCounts = std::array<std::uint64_t, HardwareEventCount>;
+
+    // "cycles", "instructions", "cache_misses", "vector_instructions"
+    const char *hardware_event_name(HardwareEvent event) noexcept;
+
+    // Probe the counters on the calling thread and start counting on success;
+    // returns the names of the events that are counted
+    std::expected<std::string, std::string> enable_hardware_counters();
+
+    bool hardware_counters_enabled() noexcept;
+
+    // Whether `event` is among the counted events
+    bool hardware_event_available(HardwareEvent event) noexcept;
+
+    // Counts of the calling thread so far; false if its counters could not
+    // be opened or read
+    bool read_hardware_counters(HardwareCounts &counts) noexcept;
+};
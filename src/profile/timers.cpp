@@ -0,0 +1,377 @@
+#include "timers.h"
+#include "counters.h"
+#include "io/json.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct TimerNode
+    {
+        std::string name;
+        std::size_t parent = 0;
+        std::vector<std::size_t> children;
+
+        std::uint64_t calls = 0;
+        std::int64_t total_ns = 0;
+        std::int64_t min_ns = INT64_MAX;
+        std::int64_t max_ns = 0;
+
+        Profile::HardwareCounts hardware{};
+    };
+
+    // Closed span of a thread's timeline
+    struct TraceEvent
+    {
+        std::string name;
+        std::int64_t begin_ns;
+        std::int64_t end_ns;
+        std::string args;
+    };
+
+    // Timers of one thread; node 0 is the root
+    struct TimerTree
+    {
+        std::vector<TimerNode> nodes = std::vector<TimerNode>(1);
+        std::size_t current = 0;
+        std::size_t thread = 0;
+        std::vector<TraceEvent> events; // only filled while tracing
+
+        std::size_t child(std::size_t parent, std::string_view name)
+        {
+            for (std::size_t c : nodes[parent].children)
+            {
+                if (nodes[c].name == name)
+                    return c;
+            }
+
+            const std::size_t index = nodes.size();
+            nodes.push_back(TimerNode{std::string(name), parent, {}});
+            nodes[parent].children.push_back(index);
+            return index;
+        }
+    };
+
+    // Trees of every thread that ever timed something
+    std::mutex registry_mutex;
+    std::vector<std::unique_ptr<TimerTree>> registry;
+    const Clock::time_point program_start = Clock::now();
+    std::atomic<bool> tracing{false};
+
+    TimerTree &local_tree()
+    {
+        thread_local TimerTree *tree = nullptr;
+        if (!tree)
+        {
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            registry.push_back(std::make_unique<TimerTree>());
+            tree = registry.back().get();
+            tree->thread = registry.size() - 1;
+        }
+        return *tree;
+    }
+
+    // One phase of the merged report
+    struct MergedNode
+    {
+        std::uint64_t calls = 0;
+        std::int64_t total_ns = 0;
+        std::int64_t min_ns = INT64_MAX;
+        std::int64_t max_ns = 0;
+
+        std::map<std::size_t, std::pair<std::uint64_t, std::int64_t>> threads; // thread -> calls, time
+        Profile::HardwareCounts hardware{};
+
+        std::vector<std::string> order; // children in order of first appearance
+        std::map<std::string, MergedNode> children;
+    };
+
+    void merge(const TimerTree &tree, std::size_t index, MergedNode &into)
+    {
+        for (std::size_t c : tree.nodes[index].children)
+        {
+            const TimerNode &node = tree.nodes[c];
+
+            auto [it, inserted] = into.children.try_emplace(node.name);
+            if (inserted)
+                into.order.push_back(node.name);
+
+            MergedNode &merged = it->second;
+            if (node.calls > 0)
+            {
+                merged.calls += node.calls;
+                merged.total_ns += node.total_ns;
+                merged.min_ns = std::min(merged.min_ns, node.min_ns);
+                merged.max_ns = std::max(merged.max_ns, node.max_ns);
+                for (std::size_t e = 0; e < node.hardware.size(); ++e)
+                    merged.hardware[e] += node.hardware[e];
+
+                auto &thread = merged.threads[tree.thread];
+                thread.first += node.calls;
+                thread.second += node.total_ns;
+            }
+
+            merge(tree, c, merged);
+        }
+    }
+
+    std::int64_t since_start(Clock::time_point t)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t - program_start).count();
+    }
+
+    double seconds(std::int64_t ns)
+    {
+        return static_cast<double>(ns) * 1e-9;
+    }
+
+    // Counted events of a phase, with instructions per cycle and cache
+    // misses per thousand instructions
+    void write_hardware(std::string &out, const Profile::HardwareCounts &counts)
+    {
+        using namespace Profile;
+
+        out += ",\"hardware\":{";
+        bool first = true;
+        for (std::size_t e = 0; e < HardwareEventCount; ++e)
+        {
+            const auto event = static_cast<HardwareEvent>(e);
+            if (!hardware_event_available(event))
+                continue;
+
+            std::format_to(std::back_inserter(out), "{}\"{}\":{}", first ? "" : ",", hardware_event_name(event), counts[e]);
+            first = false;
+        }
+
+        if (counts[Cycles] > 0)
+            std::format_to(std::back_inserter(out), ",\"ipc\":{:.4f}", static_cast<double>(counts[Instructions]) / static_cast<double>(counts[Cycles]));
+        if (counts[Instructions] > 0 && hardware_event_available(CacheMisses))
+            std::format_to(std::back_inserter(out), ",\"cache_misses_per_kilo_instruction\":{:.4f}",
+                           1e3 * static_cast<double>(counts[CacheMisses]) / static_cast<double>(counts[Instructions]));
+
+        out += "}";
+    }
+
+    void write_children(std::string &out, const MergedNode &node, int depth)
+    {
+        const std::string indent(2 * depth, ' ');
+        out += "[";
+
+        for (std::size_t i = 0; i < node.order.size(); ++i)
+        {
+            const std::string &name = node.order[i];
+            const MergedNode &child = node.children.at(name);
+
+            std::format_to(std::back_inserter(out), "{}\n{}  {{\"name\":\"{}\",\"calls\":{},\"total_seconds\":{:.9f},\"min_seconds\":{:.9f},\"max_seconds\":{:.9f},\"threads\":[",
+                           i ? "," : "", indent, json_escape(name), child.calls, seconds(child.total_ns),
+                           seconds(child.calls ? child.min_ns : 0), seconds(child.max_ns));
+
+            bool first = true;
+            for (const auto &[thread, stats] : child.threads)
+            {
+                std::format_to(std::back_inserter(out), "{}{{\"thread\":{},\"calls\":{},\"total_seconds\":{:.9f}}}",
+                               first ? "" : ",", thread, stats.first, seconds(stats.second));
+                first = false;
+            }
+
+            out += "]";
+            if (Profile::hardware_counters_enabled())
+                write_hardware(out, child.hardware);
+
+            out += ",\"children\":";
+            write_children(out, child, depth + 1);
+            out += "}";
+        }
+
+        out += node.order.empty() ? "]" : "\n" + indent + "]";
+    }
+}
+
+Profile::ScopedTimer::ScopedTimer(std::string_view name)
+{
+    TimerTree &tree = local_tree();
+    tree_ = &tree;
+    node_ = tree.child(tree.current, name);
+    tree.current = node_;
+
+    if (hardware_counters_enabled())
+        counting_ = read_hardware_counters(start_counts_);
+
+    start_ = Clock::now();
+}
+
+Profile::ScopedTimer::~ScopedTimer()
+{
+    const Clock::time_point end = Clock::now();
+    const std::int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start_).count();
+
+    TimerTree &tree = *static_cast<TimerTree *>(tree_);
+    TimerNode &node = tree.nodes[node_];
+    ++node.calls;
+    node.total_ns += elapsed;
+    node.min_ns = std::min(node.min_ns, elapsed);
+    node.max_ns = std::max(node.max_ns, elapsed);
+
+    HardwareCounts end_counts;
+    if (counting_ && read_hardware_counters(end_counts))
+    {
+        for (std::size_t e = 0; e < end_counts.size(); ++e)
+            node.hardware[e] += end_counts[e] - start_counts_[e];
+    }
+
+    if (tracing.load(std::memory_order_relaxed))
+        tree.events.push_back({node.name, since_start(start_), since_start(end), {}});
+
+    tree.current = node.parent;
+}
+
+Profile::TimerContext Profile::current_context()
+{
+    const TimerTree &tree = local_tree();
+
+    TimerContext context;
+    for (std::size_t n = tree.current; n != 0; n = tree.nodes[n].parent)
+        context.push_back(tree.nodes[n].name);
+
+    std::reverse(context.begin(), context.end());
+    return context;
+}
+
+Profile::ContextScope::ContextScope(const TimerContext &context)
+{
+    TimerTree &tree = local_tree();
+    tree_ = &tree;
+    previous_ = tree.current;
+
+    std::size_t node = 0;
+    for (const std::string &name : context)
+        node = tree.child(node, name);
+
+    tree.current = node;
+}
+
+Profile::ContextScope::~ContextScope()
+{
+    static_cast<TimerTree *>(tree_)->current = previous_;
+}
+
+std::string Profile::timer_report_json()
+{
+    MergedNode root;
+    std::size_t nthreads = 0;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (const auto &tree : registry)
+            merge(*tree, 0, root);
+        nthreads = registry.size();
+    }
+
+    std::string out = std::format("{{\"wall_seconds\":{:.9f},\"threads\":{},\"phases\":",
+                                  std::chrono::duration<double>(Clock::now() - program_start).count(), nthreads);
+    write_children(out, root, 0);
+
+    // Integral workload of the same run, when counted
+    if constexpr (counters_enabled())
+        out += ",\"integrals\":" + counter_report_json();
+
+    out += "}\n";
+    return out;
+}
+
+std::expected<void, std::string> Profile::write_timer_report(const std::string &filename)
+{
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file)
+        return std::unexpected("Cannot write " + filename);
+
+    file << timer_report_json();
+    if (!file)
+        return std::unexpected("Failed writing " + filename);
+
+    return {};
+}
+
+void Profile::enable_tracing() noexcept
+{
+    tracing.store(true, std::memory_order_relaxed);
+}
+
+bool Profile::tracing_enabled() noexcept
+{
+    return tracing.load(std::memory_order_relaxed);
+}
+
+void Profile::trace_span(std::string_view name, Clock::time_point begin, Clock::time_point end, std::string args)
+{
+    if (!tracing.load(std::memory_order_relaxed))
+        return;
+
+    local_tree().events.push_back({std::string(name), since_start(begin), since_start(end), std::move(args)});
+}
+
+std::expected<void, std::string> Profile::write_trace(const std::string &filename, int process)
+{
+    std::ofstream file(filename, std::ios::trunc);
+    if (!file)
+        return std::unexpected("Cannot write " + filename);
+
+    // Complete events ("X") with microsecond timestamps, plus a name per thread
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        for (const auto &tree : registry)
+        {
+            if (tree->events.empty())
+                continue;
+
+            std::format_to(std::back_inserter(out), "{}\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":\"thread {}\"}}}}",
+                           first ? "" : ",", process, tree->thread, tree->thread);
+            first = false;
+
+            for (const TraceEvent &event : tree->events)
+            {
+                std::format_to(std::back_inserter(out), ",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":{},\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}",
+                               json_escape(event.name), process, tree->thread,
+                               static_cast<double>(event.begin_ns) * 1e-3, static_cast<double>(event.end_ns - event.begin_ns) * 1e-3);
+                if (!event.args.empty())
+                    out += ",\"args\":" + event.args;
+                out += "}";
+            }
+        }
+    }
+    out += "\n]}\n";
+
+    file << out;
+    if (!file)
+        return std::unexpected("Failed writing " + filename);
+
+    return {};
+}
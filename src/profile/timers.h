@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hardware.h"
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Hierarchical phase timers
+//
+// Every thread keeps its own tree of named timers; a ScopedTimer opened while
+// another one is running on the same thread becomes its child. Threads of a
+// parallel region start from the context of the thread that opened it (see
+// ContextScope), so their work shows up under the phase that spawned them.
+// The report merges the trees of all threads by path and lists, for each
+// phase, the calls and time of every thread that took part. With hardware
+// counters enabled (see hardware.h) each phase also carries their counts.
+//
+// With tracing on, every timer also leaves a span on its thread's timeline,
+// next to the spans other code records directly (the tasks of the pool);
+// the timeline is written in Chrome trace-event format for Perfetto or
+// chrome://tracing.
+namespace Profile
+{
+    // Names from the root to the innermost running timer of a thread
+    using TimerContext = std::vector<std::string>;
+
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(std::string_view name);
+        ~ScopedTimer();
+
+        ScopedTimer(const ScopedTimer &) = delete;
+        ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    private:
+        void *tree_;
+        std::size_t node_;
+        std::chrono::steady_clock::time_point start_;
+        bool counting_ = false; // hardware counters read at the start
+        HardwareCounts start_counts_;
+    };
+
+    // Context of the calling thread, to hand to the threads of a parallel region
+    TimerContext current_context();
+
+    // Nest the calling thread's timers under `context` while the scope lives
+    class ContextScope
+    {
+    public:
+        explicit ContextScope(const TimerContext &context);
+        ~ContextScope();
+
+        ContextScope(const ContextScope &) = delete;
+        ContextScope &operator=(const ContextScope &) = delete;
+
+    private:
+        void *tree_;
+        std::size_t previous_;
+    };
+
+    // Merged report of all threads as JSON; no timer may be running on
+    // another thread while it is built
+    std::string timer_report_json();
+
+    std::expected<void, std::string> write_timer_report(const std::string &filename);
+
+    // Start recording spans; off by default, and checking it costs one load
+    void enable_tracing() noexcept;
+    bool tracing_enabled() noexcept;
+
+    // Span on the calling thread's timeline; `args` is a JSON object shown
+    // with the span, or empty
+    void trace_span(std::string_view name, std::chrono::steady_clock::time_point begin,
+                    std::chrono::steady_clock::time_point end, std::string args = {});
+
+    // Timeline of all threads as Chrome trace-event JSON, with `process`
+    // (the MPI rank) as its process id; no span may be recorded meanwhile
+    std::expected<void, std::string> write_trace(const std::string &filename, int process = 0);
+};
@@ -0,0 +1,87 @@
+#include "basis/compiled.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+ * Planck
+ * Copyright (C) 2024 Hemanth Haridas, University of Utah
+ * Contact: hemanthhari23@gmail.com
+ *
+ * This program is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or a later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+ * PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ ----------------------------------------------------------------------------*/
+
+// Compile .gbs basis set files into memory-mappable images
+//
+// Usage: planck-basis-compile <basis file | directory> ...
+// Every basis file is compiled to <file>.pbin next to it. Run by the install
+// step over share/basis-sets; rerun it after editing a basis file (stale
+// images are ignored at run time, so forgetting only costs speed).
+
+namespace fs = std::filesystem;
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << std::format("Usage : {} <basis file | directory> ...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<fs::path> sources;
+    for (int i = 1; i < argc; ++i)
+    {
+        const fs::path path = argv[i];
+        if (!fs::is_directory(path))
+        {
+            sources.push_back(path);
+            continue;
+        }
+
+        for (const auto &entry : fs::directory_iterator(path))
+        {
+            const std::string extension = entry.path().extension().string();
+            if (entry.is_regular_file() && extension != COMPILED_BASIS_EXTENSION && extension != ".tmp")
+                sources.push_back(entry.path());
+        }
+    }
+
+    int status = EXIT_SUCCESS;
+    for (const fs::path &source : sources)
+    {
+        const std::string target = source.string() + COMPILED_BASIS_EXTENSION;
+
+        if (auto res = compile_basis_set(source.string(), target); !res)
+        {
+            std::cerr << std::format("{} : {}\n", source.string(), res.error());
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        auto compiled = CompiledBasisSet::open(target, source.string());
+        if (!compiled)
+        {
+            std::cerr << std::format("{} : {}\n", target, compiled.error());
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        const CompiledHeader &header = compiled->header();
+        std::cout << std::format("{} : {} elements, {} shells, {} primitives\n", target, header.nelements, header.nshells, header.nprimitives);
+    }
+
+    return status;
+}